@@ -0,0 +1,267 @@
+#include "CorpusGenerator.hpp"
+
+#include "DuffVersion.h"
+#include "HashCalculator.hpp"
+#include "ResultModel.hpp"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <iostream>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#include <Psapi.h>
+#else
+#include <sys/resource.h>
+#endif
+
+// Every benchmark writes a single JSON object on a line of its own to the standard output,
+// so that results of different commits can be collected into one file and compared
+
+namespace
+{
+	qint64 peakResidentBytes()
+	{
+#ifdef Q_OS_WIN
+		PROCESS_MEMORY_COUNTERS counters = {};
+		return GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)) ?
+			qint64(counters.PeakWorkingSetSize) : -1;
+#else
+		rusage usage = {};
+
+		if (getrusage(RUSAGE_SELF, &usage) != 0)
+		{
+			return -1;
+		}
+#ifdef Q_OS_DARWIN
+		return qint64(usage.ru_maxrss);
+#else
+		return qint64(usage.ru_maxrss) * 1024;
+#endif
+#endif
+	}
+
+	double perSecond(qint64 count, qint64 nanoseconds)
+	{
+		return nanoseconds > 0 ? count * 1e9 / nanoseconds : 0.0;
+	}
+
+	void writeResult(const QString& benchmark, QJsonObject result)
+	{
+		result.insert("benchmark", benchmark);
+		result.insert("commit", DUFF_COMMIT_HASH);
+		result.insert("peakRssBytes", peakResidentBytes());
+		std::cout << QJsonDocument(result).toJson(QJsonDocument::Compact).constData() << std::endl;
+	}
+
+	int generate(const QCommandLineParser& parser)
+	{
+		CorpusGenerator::Options options;
+		options.root = parser.value("root");
+		options.fileCount = parser.value("files").toLongLong();
+		options.minSize = parser.value("min-size").toLongLong();
+		options.maxSize = parser.value("max-size").toLongLong();
+		options.distribution = parser.value("distribution") == "uniform" ?
+			CorpusGenerator::Distribution::Uniform :
+			CorpusGenerator::Distribution::LogNormal;
+		options.duplicateRatio = parser.value("duplicates").toDouble();
+		options.hardlinkRatio = parser.value("hardlinks").toDouble();
+		options.depth = parser.value("depth").toInt();
+		options.fanout = qMax(1, parser.value("fanout").toInt());
+		options.seed = parser.value("seed").toULongLong();
+
+		QElapsedTimer timer;
+		timer.start();
+
+		CorpusGenerator generator(options);
+		CorpusGenerator::Summary summary;
+
+		if (!generator.generate(summary))
+		{
+			return 2;
+		}
+
+		writeResult("generate",
+		{
+			{ "files", summary.files },
+			{ "bytes", summary.bytes },
+			{ "duplicates", summary.duplicates },
+			{ "hardlinks", summary.hardlinks },
+			{ "directories", summary.directories },
+			{ "seed", QString::number(options.seed) },
+			{ "elapsedNs", timer.nsecsElapsed() }
+		});
+
+		return 0;
+	}
+
+	int scan(QCoreApplication& application, const QCommandLineParser& parser)
+	{
+		qRegisterMetaType<HashCalculator::ErrorType>("ErrorType");
+		qRegisterMetaType<DuplicateList>("DuplicateList");
+
+		const Hasher::Algorithm algorithm = parser.value("algorithm") == "fast128" ?
+			Hasher::Algorithm::Fast128 :
+			Hasher::Algorithm::Sha256;
+		const std::optional<FileReader::Mode> readMode = FileReader::modeByName(parser.value("read-mode"));
+
+		if (!readMode)
+		{
+			std::cerr << "Unknown read mode: " << qPrintable(parser.value("read-mode")) << std::endl;
+			return 2;
+		}
+
+		HashCalculator calculator(nullptr);
+		calculator.setDirectory(parser.value("root"));
+		calculator.setThreadCount(parser.value("threads").toInt());
+		calculator.setAlgorithm(algorithm);
+		calculator.setReadMode(readMode.value());
+		calculator.setQueueDepth(parser.value("queue-depth").toInt());
+		// A warm cache measures the cache, not the engine
+		calculator.setCacheEnabled(parser.isSet("cache"));
+
+		qint64 reported = 0;
+
+		QObject::connect(&calculator, &HashCalculator::duplicatesFound, [&](const DuplicateList& duplicates)
+		{
+			reported += duplicates.size();
+		});
+
+		QObject::connect(&calculator, &HashCalculator::finished, &application, &QCoreApplication::quit);
+
+		QElapsedTimer timer;
+		timer.start();
+		calculator.start();
+		application.exec();
+
+		const qint64 elapsed = timer.nsecsElapsed();
+		const ScanProgress::Snapshot progress = calculator.progress();
+		const qint64 files = progress.value(ScanProgress::FilesFound);
+		const qint64 bytes = progress.value(ScanProgress::BytesRead);
+
+		writeResult("scan",
+		{
+			{ "algorithm", Hasher::name(algorithm) },
+			{ "readMode", FileReader::name(readMode.value()) },
+			{ "queueDepth", calculator.queueDepth() },
+			{ "files", files },
+			{ "candidates", progress.value(ScanProgress::Candidates) },
+			{ "bytesRead", bytes },
+			{ "duplicates", reported },
+			{ "elapsedNs", elapsed },
+			{ "filesPerSecond", perSecond(files, elapsed) },
+			{ "bytesPerSecond", perSecond(bytes, elapsed) }
+		});
+
+		return 0;
+	}
+
+	int model(const QCommandLineParser& parser)
+	{
+		const qint64 rows = parser.value("rows").toLongLong();
+		const qint64 groupSize = qMax(2, parser.value("group-size").toInt());
+		const qint64 batchSize = qMax(1, parser.value("batch").toInt());
+
+		ResultModel resultModel;
+		DuplicateList batch;
+		QElapsedTimer timer;
+		qint64 insertionTime = 0;
+
+		// Only the insertion is timed, building the input is not
+		for (qint64 row = 0; row < rows; ++row)
+		{
+			const qint64 group = row / groupSize;
+
+			batch.append(
+			{
+				QString::number(group, 16).rightJustified(32, '0'),
+				QString("/corpus/d%1/d%2/%3.bin").arg(row % 16).arg(row / 16 % 16).arg(row),
+				// Varying sizes, so that the sort has something to do
+				group * 7919 % 0x10000,
+				false
+			});
+
+			if (batch.size() == batchSize || row == rows - 1)
+			{
+				timer.start();
+				resultModel.addPaths(batch);
+				insertionTime += timer.nsecsElapsed();
+				batch.clear();
+			}
+		}
+
+		timer.start();
+		resultModel.sort(ResultModel::ReclaimableColumn, Qt::DescendingOrder);
+		const qint64 sortTime = timer.nsecsElapsed();
+
+		writeResult("model",
+		{
+			{ "rows", rows },
+			{ "groupSize", groupSize },
+			{ "batch", batchSize },
+			{ "insertionNs", insertionTime },
+			{ "nsPerRow", rows > 0 ? double(insertionTime) / rows : 0.0 },
+			{ "rowsPerSecond", perSecond(rows, insertionTime) },
+			{ "sortNs", sortTime }
+		});
+
+		return 0;
+	}
+}
+
+int main(int argc, char* argv[])
+{
+	QCoreApplication application(argc, argv);
+
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Duff scan engine benchmarks");
+	parser.addHelpOption();
+	parser.addPositionalArgument("benchmark", "generate, scan or model");
+
+	parser.addOptions(
+	{
+		{ "root", "Corpus directory.", "directory" },
+		{ "files", "generate: number of files.", "count", "1000" },
+		{ "min-size", "generate: smallest file size in bytes.", "bytes", "1" },
+		{ "max-size", "generate: largest file size in bytes.", "bytes", "65536" },
+		{ "distribution", "generate: lognormal or uniform.", "name", "lognormal" },
+		{ "duplicates", "generate: ratio of files copied from an earlier one.", "ratio", "0.2" },
+		{ "hardlinks", "generate: ratio of files hard linked to an earlier one.", "ratio", "0" },
+		{ "depth", "generate: directory depth.", "levels", "3" },
+		{ "fanout", "generate: subdirectories per directory.", "count", "8" },
+		{ "seed", "generate: random seed.", "seed", "1" },
+		{ "algorithm", "scan: sha256 or fast128.", "name", "sha256" },
+		{ "threads", "scan: hashing threads, 0 for one per core.", "count", "0" },
+		{ "read-mode", "scan: buffered, mmap, direct or uring.", "mode", "buffered" },
+		{ "queue-depth", "scan: reads in flight per thread with uring.", "depth", "32" },
+		{ "cache", "scan: use the persistent hash cache." },
+		{ "rows", "model: number of rows to insert.", "count", "1000000" },
+		{ "group-size", "model: paths per duplicate group.", "count", "2" },
+		{ "batch", "model: duplicates per insertion.", "count", "1024" }
+	});
+
+	parser.process(application);
+
+	const QString benchmark = parser.positionalArguments().value(0);
+
+	if (benchmark == "generate")
+	{
+		return generate(parser);
+	}
+
+	if (benchmark == "scan")
+	{
+		return scan(application, parser);
+	}
+
+	if (benchmark == "model")
+	{
+		return model(parser);
+	}
+
+	parser.showHelp(2);
+}
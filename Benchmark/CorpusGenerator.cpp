@@ -0,0 +1,169 @@
+#include "CorpusGenerator.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QSet>
+
+#include <cmath>
+#include <filesystem>
+#include <vector>
+
+namespace
+{
+	std::filesystem::path toPath(const QString& filePath)
+	{
+#ifdef Q_OS_WIN
+		return std::filesystem::path(filePath.toStdWString());
+#else
+		return std::filesystem::path(QFile::encodeName(filePath).toStdString());
+#endif
+	}
+}
+
+CorpusGenerator::CorpusGenerator(const Options& options) :
+	_options(options),
+	_random(options.seed)
+{
+}
+
+bool CorpusGenerator::generate(Summary& summary)
+{
+	// Sources are drawn uniformly from the unique files written so far
+	std::vector<Source> sources;
+	std::uniform_real_distribution<double> kind(0.0, 1.0);
+	QSet<QString> directories;
+	QDir root(_options.root);
+
+	for (qint64 i = 0; i < _options.fileCount; ++i)
+	{
+		const QString directory = directoryFor(i);
+
+		if (!directories.contains(directory))
+		{
+			if (!root.mkpath(directory))
+			{
+				qWarning() << "Failed to create" << directory;
+				return false;
+			}
+
+			directories.insert(directory);
+		}
+
+		const QString path = root.filePath(QString("%1/%2.bin").arg(directory).arg(i));
+		const double roll = kind(_random);
+
+		if (!sources.empty() && roll < _options.hardlinkRatio)
+		{
+			const Source& source = sources[_random() % sources.size()];
+			std::error_code code;
+			std::filesystem::create_hard_link(toPath(source.path), toPath(path), code);
+
+			if (code)
+			{
+				qWarning() << "Failed to link" << path << code.message().c_str();
+				return false;
+			}
+
+			++summary.hardlinks;
+		}
+		else if (!sources.empty() && roll < _options.hardlinkRatio + _options.duplicateRatio)
+		{
+			const Source& source = sources[_random() % sources.size()];
+
+			if (!writeFile(path, source.size, source.contentSeed))
+			{
+				return false;
+			}
+
+			summary.bytes += source.size;
+			++summary.duplicates;
+		}
+		else
+		{
+			const Source source = { path, drawSize(), _options.seed ^ (quint64(i) << 1 | 1) };
+
+			if (!writeFile(path, source.size, source.contentSeed))
+			{
+				return false;
+			}
+
+			summary.bytes += source.size;
+			sources.push_back(source);
+		}
+
+		++summary.files;
+	}
+
+	summary.directories = directories.size();
+	return true;
+}
+
+qint64 CorpusGenerator::drawSize()
+{
+	double size = 0;
+
+	if (_options.distribution == Distribution::Uniform)
+	{
+		size = std::uniform_real_distribution<double>(double(_options.minSize), double(_options.maxSize))(_random);
+	}
+	else
+	{
+		// The median sits at the geometric mean of the bounds, three sigmas span the range
+		const double low = std::log(double(qMax<qint64>(1, _options.minSize)));
+		const double high = std::log(double(qMax<qint64>(1, _options.maxSize)));
+		size = std::exp(std::normal_distribution<double>((low + high) / 2, (high - low) / 6)(_random));
+	}
+
+	// Empty files are never duplicates, the engine skips them
+	return qBound<qint64>(qMax<qint64>(1, _options.minSize), qint64(size), qMax<qint64>(1, _options.maxSize));
+}
+
+QString CorpusGenerator::directoryFor(qint64 index) const
+{
+	// Files are spread round robin over the leaves of the tree
+	QStringList parts;
+	qint64 leaf = index;
+
+	for (int level = 0; level < _options.depth; ++level)
+	{
+		parts.append(QString("d%1").arg(leaf % _options.fanout));
+		leaf /= _options.fanout;
+	}
+
+	return parts.isEmpty() ? QString(".") : parts.join('/');
+}
+
+bool CorpusGenerator::writeFile(const QString& path, qint64 size, quint64 contentSeed) const
+{
+	QFile file(path);
+
+	if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate))
+	{
+		qWarning() << "Failed to open" << path << file.errorString();
+		return false;
+	}
+
+	std::mt19937_64 content(contentSeed);
+	std::vector<quint64> block(0x2000); // 64K
+
+	for (qint64 written = 0; written < size;)
+	{
+		const qint64 length = qMin<qint64>(size - written, qint64(block.size() * sizeof(quint64)));
+
+		for (qint64 word = 0; word * qint64(sizeof(quint64)) < length; ++word)
+		{
+			block[word] = content();
+		}
+
+		if (file.write(reinterpret_cast<const char*>(block.data()), length) != length)
+		{
+			qWarning() << "Failed to write" << path << file.errorString();
+			return false;
+		}
+
+		written += length;
+	}
+
+	return true;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QString>
+#include <random>
+
+// Creates a reproducible directory tree for benchmarking the scan engine.
+// The same options and seed always produce byte identical files at the same paths
+class CorpusGenerator
+{
+public:
+	enum class Distribution
+	{
+		Uniform,
+		LogNormal // Most files small, a long tail of large ones, like real trees
+	};
+
+	struct Options
+	{
+		QString root;
+		qint64 fileCount = 1000;
+		qint64 minSize = 1;
+		qint64 maxSize = 0x10000; // 64K
+		Distribution distribution = Distribution::LogNormal;
+		double duplicateRatio = 0.2; // Of all files, copies of an earlier file
+		double hardlinkRatio = 0.0; // Of all files, hard links to an earlier file
+		int depth = 3;
+		int fanout = 8; // Subdirectories per directory
+		quint64 seed = 1;
+	};
+
+	struct Summary
+	{
+		qint64 files = 0;
+		qint64 bytes = 0;
+		qint64 duplicates = 0;
+		qint64 hardlinks = 0;
+		qint64 directories = 0; // Leaves only
+	};
+
+	explicit CorpusGenerator(const Options& options);
+
+	// Returns false if anything could not be written
+	bool generate(Summary& summary);
+
+private:
+	struct Source
+	{
+		QString path;
+		qint64 size;
+		quint64 contentSeed;
+	};
+
+	qint64 drawSize();
+	QString directoryFor(qint64 index) const;
+	bool writeFile(const QString& path, qint64 size, quint64 contentSeed) const;
+
+	const Options _options;
+	std::mt19937_64 _random;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QQueue>
+#include <QWaitCondition>
+
+// A blocking FIFO for handing work from one pipeline stage to the next.
+// The fixed capacity makes a fast producer wait for the consumers,
+// which keeps the memory use flat. The time spent waiting is recorded
+// so the stages can be measured separately.
+template <typename T>
+class BoundedQueue
+{
+public:
+	explicit BoundedQueue(qsizetype capacity) :
+		_capacity(capacity)
+	{
+	}
+
+	// Blocks while the queue is full. Returns false if the queue is closed.
+	bool push(const T& item)
+	{
+		QMutexLocker lock(&_mutex);
+
+		if (_items.size() >= _capacity && !_closed)
+		{
+			QElapsedTimer timer;
+			timer.start();
+
+			while (_items.size() >= _capacity && !_closed)
+			{
+				_notFull.wait(&_mutex);
+			}
+
+			_producerWaitTime += timer.nsecsElapsed();
+		}
+
+		if (_closed)
+		{
+			return false;
+		}
+
+		_items.enqueue(item);
+		_notEmpty.wakeOne();
+		return true;
+	}
+
+	// Blocks while the queue is empty. Returns false once the queue is closed and drained.
+	bool pop(T& item)
+	{
+		QMutexLocker lock(&_mutex);
+
+		if (_items.isEmpty() && !_closed)
+		{
+			QElapsedTimer timer;
+			timer.start();
+
+			while (_items.isEmpty() && !_closed)
+			{
+				_notEmpty.wait(&_mutex);
+			}
+
+			_consumerWaitTime += timer.nsecsElapsed();
+		}
+
+		if (_items.isEmpty())
+		{
+			return false;
+		}
+
+		item = _items.dequeue();
+		_notFull.wakeOne();
+		return true;
+	}
+
+	// A hint only, another consumer may take the last item right after
+	bool isEmpty() const
+	{
+		QMutexLocker lock(&_mutex);
+		return _items.isEmpty();
+	}
+
+	// No more items will be pushed, the consumers drain what is left
+	void close()
+	{
+		QMutexLocker lock(&_mutex);
+		_closed = true;
+		_notEmpty.wakeAll();
+		_notFull.wakeAll();
+	}
+
+	// Total nanoseconds the producers were blocked by a full queue
+	qint64 producerWaitTime() const
+	{
+		QMutexLocker lock(&_mutex);
+		return _producerWaitTime;
+	}
+
+	// Total nanoseconds the consumers were blocked by an empty queue
+	qint64 consumerWaitTime() const
+	{
+		QMutexLocker lock(&_mutex);
+		return _consumerWaitTime;
+	}
+
+private:
+	const qsizetype _capacity;
+	mutable QMutex _mutex;
+	QWaitCondition _notEmpty;
+	QWaitCondition _notFull;
+	QQueue<T> _items;
+	bool _closed = false;
+	qint64 _producerWaitTime = 0;
+	qint64 _consumerWaitTime = 0;
+};
@@ -0,0 +1,354 @@
+#include "ConsoleScanner.hpp"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <csignal>
+#include <iostream>
+#include <limits>
+
+namespace
+{
+	const char HeadlessOption[] = "headless";
+
+	volatile std::sig_atomic_t interruptSignal = 0;
+
+	void onInterruptSignal(int signal)
+	{
+		interruptSignal = 1;
+
+		// A second one ends the process right away
+		std::signal(signal, SIG_DFL);
+	}
+
+	QString csvField(const QString& value)
+	{
+		if (!value.contains(',') && !value.contains('"') && !value.contains('\n'))
+		{
+			return value;
+		}
+
+		return '"' + QString(value).replace('"', "\"\"") + '"';
+	}
+
+	// Bytes, optionally with a K, M, G or T suffix of binary multiples
+	std::optional<qint64> parseSize(QString value)
+	{
+		const QString units = "KMGT";
+		const qsizetype unit = value.isEmpty() ? -1 : units.indexOf(value.back().toUpper());
+
+		if (unit >= 0)
+		{
+			value.chop(1);
+		}
+
+		bool isNumber = false;
+		const qint64 size = value.toLongLong(&isNumber);
+		const int shift = 10 * int(unit + 1);
+
+		if (!isNumber || size < 0 || size > std::numeric_limits<qint64>::max() >> shift)
+		{
+			return std::nullopt;
+		}
+
+		return size << shift;
+	}
+
+	// Seconds since the epoch, the fallback if the value is empty
+	std::optional<qint64> parseTime(const QString& value, qint64 fallback)
+	{
+		if (value.isEmpty())
+		{
+			return fallback;
+		}
+
+		const QDateTime time = QDateTime::fromString(value, Qt::ISODate);
+
+		if (!time.isValid())
+		{
+			return std::nullopt;
+		}
+
+		return time.toSecsSinceEpoch();
+	}
+
+	std::optional<Hasher::Algorithm> algorithmByName(const QString& name)
+	{
+		for (Hasher::Algorithm algorithm :
+		{
+			Hasher::Algorithm::Md5,
+			Hasher::Algorithm::Sha1,
+			Hasher::Algorithm::Sha256,
+			Hasher::Algorithm::Sha512,
+			Hasher::Algorithm::Fast128
+		})
+		{
+			// Accepts "SHA-256", "sha256" and so on
+			if (Hasher::name(algorithm).remove('-').compare(QString(name).remove('-'), Qt::CaseInsensitive) == 0)
+			{
+				return algorithm;
+			}
+		}
+
+		return std::nullopt;
+	}
+}
+
+ConsoleScanner::ConsoleScanner(QObject* parent) :
+	QObject(parent),
+	_hashCalculator(new HashCalculator(this)),
+	_interruptTimer(new QTimer(this))
+{
+	qRegisterMetaType<HashCalculator::ErrorType>("ErrorType");
+	qRegisterMetaType<DuplicateList>("DuplicateList");
+
+	connect(_hashCalculator, &HashCalculator::duplicatesFound, this, &ConsoleScanner::onDuplicatesFound);
+	connect(_hashCalculator, &HashCalculator::failure, this, &ConsoleScanner::onFailure);
+	connect(_hashCalculator, &HashCalculator::finished, this, &ConsoleScanner::onFinished);
+
+	_interruptTimer->setInterval(InterruptPollInterval);
+	connect(_interruptTimer, &QTimer::timeout, this, &ConsoleScanner::onInterruptPolled);
+}
+
+bool ConsoleScanner::isRequested(int argc, char* argv[])
+{
+	// Checked before any application object exists, the GUI one needs a display
+	const QByteArray option = QByteArray("--") + HeadlessOption;
+
+	for (int i = 1; i < argc; ++i)
+	{
+		if (option == argv[i])
+		{
+			return true;
+		}
+	}
+
+	return false;
+}
+
+bool ConsoleScanner::parseArguments(const QStringList& arguments)
+{
+	QCommandLineParser parser;
+	parser.setApplicationDescription("Duff - Duplicate File Finder");
+	parser.addHelpOption();
+	parser.addPositionalArgument("directories", "The directories to search for duplicates.", "<directory>...");
+
+	parser.addOptions(
+	{
+		{ HeadlessOption, "Run without a GUI, write the duplicates to the standard output." },
+		{ { "a", "algorithm" }, "MD5, SHA-1, SHA-256, SHA-512 or Fast128. Default: SHA-256.", "algorithm", "SHA-256" },
+		{ { "w", "wildcards" }, "Pipe separated file name patterns, e.g. \"*.jpg|*.png\". "
+			"Prefix with ! to exclude, end with / to skip directories, e.g. \"!.git/|!*.tmp\".", "wildcards" },
+		{ { "f", "format" }, "jsonl or csv. Default: jsonl.", "format", "jsonl" },
+		{ { "t", "threads" }, "Number of hashing threads. Default: one per core.", "threads", "0" },
+		{ "no-confirm", "Do not confirm Fast128 matches with SHA-256." },
+		{ "no-cache", "Do not use or update the hash cache." },
+		{ "compare", "Compare same size files byte by byte instead of hashing them." },
+		{ "read-mode", "buffered, mmap, direct or uring. Default: buffered.", "mode", "buffered" },
+		{ "queue-depth", "Reads in flight per thread with uring. Default: 32.", "depth", "32" },
+		{ "min-size", "Skip files smaller than this, e.g. 4K or 1M.", "size", "0" },
+		{ "max-size", "Skip files larger than this, e.g. 2G. Default: no limit.", "size", "0" },
+		{ "newer-than", "Skip files modified before this ISO 8601 date or time.", "time" },
+		{ "older-than", "Skip files modified after this ISO 8601 date or time.", "time" }
+	});
+
+	if (!parser.parse(arguments))
+	{
+		std::cerr << qPrintable(parser.errorText()) << std::endl;
+		return false;
+	}
+
+	if (parser.isSet("help"))
+	{
+		parser.showHelp(NoDuplicates);
+	}
+
+	const QStringList directories = parser.positionalArguments();
+
+	if (directories.isEmpty())
+	{
+		std::cerr << "At least one directory expected" << std::endl;
+		return false;
+	}
+
+	for (const QString& directory : directories)
+	{
+		if (!QDir(directory).exists())
+		{
+			std::cerr << qPrintable(directory) << " does not appear to exist" << std::endl;
+			return false;
+		}
+	}
+
+	const std::optional<Hasher::Algorithm> algorithm = algorithmByName(parser.value("algorithm"));
+
+	if (!algorithm)
+	{
+		std::cerr << "Unknown algorithm: " << qPrintable(parser.value("algorithm")) << std::endl;
+		return false;
+	}
+
+	const std::optional<FileReader::Mode> readMode = FileReader::modeByName(parser.value("read-mode"));
+
+	if (!readMode)
+	{
+		std::cerr << "Unknown read mode: " << qPrintable(parser.value("read-mode")) << std::endl;
+		return false;
+	}
+
+	const QString format = parser.value("format").toLower();
+
+	if (format == "jsonl")
+	{
+		_format = Format::JsonLines;
+	}
+	else if (format == "csv")
+	{
+		_format = Format::Csv;
+	}
+	else
+	{
+		std::cerr << "Unknown format: " << qPrintable(format) << std::endl;
+		return false;
+	}
+
+	bool isNumber = false;
+	const int threadCount = parser.value("threads").toInt(&isNumber);
+
+	if (!isNumber || threadCount < 0)
+	{
+		std::cerr << "Invalid thread count: " << qPrintable(parser.value("threads")) << std::endl;
+		return false;
+	}
+
+	const int queueDepth = parser.value("queue-depth").toInt(&isNumber);
+
+	if (!isNumber || queueDepth < 1 || queueDepth > HashCalculator::MaxQueueDepth)
+	{
+		std::cerr << "Invalid queue depth: " << qPrintable(parser.value("queue-depth"))
+			<< ", expected 1 to " << HashCalculator::MaxQueueDepth << std::endl;
+		return false;
+	}
+
+	const std::optional<qint64> minimumSize = parseSize(parser.value("min-size"));
+	const std::optional<qint64> maximumSize = parseSize(parser.value("max-size"));
+
+	if (!minimumSize || !maximumSize)
+	{
+		std::cerr << "Invalid size limit" << std::endl;
+		return false;
+	}
+
+	const std::optional<qint64> earliest = parseTime(parser.value("newer-than"), std::numeric_limits<qint64>::min());
+	const std::optional<qint64> latest = parseTime(parser.value("older-than"), std::numeric_limits<qint64>::max());
+
+	if (!earliest || !latest)
+	{
+		std::cerr << "Invalid time limit, expected e.g. 2024-01-31 or 2024-01-31T12:00:00" << std::endl;
+		return false;
+	}
+
+	_hashCalculator->setDirectories(directories);
+	_hashCalculator->setSizeRange(minimumSize.value(), maximumSize.value());
+	_hashCalculator->setModifiedRange(earliest.value(), latest.value());
+	_hashCalculator->setAlgorithm(algorithm.value());
+	_hashCalculator->setWildcards(parser.value("wildcards"));
+	_hashCalculator->setThreadCount(threadCount);
+	_hashCalculator->setConfirmation(!parser.isSet("no-confirm"));
+	_hashCalculator->setCacheEnabled(!parser.isSet("no-cache"));
+	_hashCalculator->setComparison(parser.isSet("compare"));
+	_hashCalculator->setReadMode(readMode.value());
+	_hashCalculator->setQueueDepth(queueDepth);
+	return true;
+}
+
+void ConsoleScanner::start()
+{
+	if (_format == Format::Csv)
+	{
+		std::cout << "hash,path,size,hardlink" << std::endl;
+	}
+
+	// Ctrl+C stops the scan, what was found so far is still written
+	std::signal(SIGINT, onInterruptSignal);
+	std::signal(SIGTERM, onInterruptSignal);
+	_interruptTimer->start();
+
+	_hashCalculator->start();
+}
+
+void ConsoleScanner::onDuplicatesFound(const DuplicateList& duplicates)
+{
+	for (const Duplicate& duplicate : duplicates)
+	{
+		write(duplicate);
+	}
+
+	// Whoever reads the output sees the batch right away
+	std::cout.flush();
+	_duplicateCount += duplicates.size();
+}
+
+void ConsoleScanner::onFailure(const QString& filePath, HashCalculator::ErrorType error)
+{
+	std::cerr << "Failed to process " << qPrintable(filePath) << ": "
+		<< qPrintable(HashCalculator::reason(error)) << std::endl;
+
+	if (error != HashCalculator::ErrorType::Empty)
+	{
+		++_failureCount;
+	}
+}
+
+void ConsoleScanner::onFinished()
+{
+	_interruptTimer->stop();
+	qDebug() << "Found" << _duplicateCount << "duplicates," << _failureCount << "failures";
+
+	if (_failureCount > 0 || _interrupted)
+	{
+		QCoreApplication::exit(Incomplete);
+		return;
+	}
+
+	QCoreApplication::exit(_duplicateCount > 0 ? DuplicatesFound : NoDuplicates);
+}
+
+void ConsoleScanner::onInterruptPolled()
+{
+	if (!interruptSignal || _interrupted)
+	{
+		return;
+	}
+
+	qDebug() << "Interrupted";
+	_interrupted = true;
+	_hashCalculator->requestInterruption();
+}
+
+void ConsoleScanner::write(const Duplicate& duplicate)
+{
+	if (_format == Format::Csv)
+	{
+		std::cout << csvField(duplicate.hash).toUtf8().constData() << ','
+			<< csvField(duplicate.filePath).toUtf8().constData() << ','
+			<< duplicate.size << ','
+			<< (duplicate.hardlink ? "true" : "false") << '\n';
+		return;
+	}
+
+	const QJsonObject record
+	{
+		{ "hash", duplicate.hash },
+		{ "path", duplicate.filePath },
+		{ "size", duplicate.size },
+		{ "hardlink", duplicate.hardlink }
+	};
+
+	std::cout << QJsonDocument(record).toJson(QJsonDocument::Compact).constData() << '\n';
+}
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <QObject>
+#include <QTimer>
+
+#include "HashCalculator.hpp"
+
+// Drives the hashing engine without a GUI and streams every duplicate
+// to the standard output as soon as it is found, one record per line
+class ConsoleScanner : public QObject
+{
+	Q_OBJECT
+
+public:
+	enum class Format
+	{
+		JsonLines,
+		Csv
+	};
+
+	// Meant for scripts, in the spirit of diff and cmp
+	enum ExitCode
+	{
+		NoDuplicates = 0,
+		DuplicatesFound = 1,
+		Error = 2,
+		// Files could not be read or the scan was interrupted, the duplicates written are still valid
+		Incomplete = 3
+	};
+
+	explicit ConsoleScanner(QObject* parent = nullptr);
+
+	// Reports the problem to the standard error and returns false if the arguments are unusable
+	bool parseArguments(const QStringList& arguments);
+	void start();
+
+	static bool isRequested(int argc, char* argv[]);
+
+private slots:
+	void onDuplicatesFound(const DuplicateList& duplicates);
+	void onFailure(const QString& filePath, HashCalculator::ErrorType error);
+	void onFinished();
+	void onInterruptPolled();
+
+private:
+	// The signal handler only sets a flag, the Qt side picks it up at this rate
+	static constexpr int InterruptPollInterval = 100; // Milliseconds
+
+	void write(const Duplicate& duplicate);
+
+	HashCalculator* _hashCalculator;
+	QTimer* _interruptTimer;
+	bool _interrupted = false;
+	Format _format = Format::JsonLines;
+	qint64 _duplicateCount = 0;
+	// Empty files are skipped by design and not counted
+	qint64 _failureCount = 0;
+};
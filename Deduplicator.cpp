@@ -0,0 +1,355 @@
+#include "Deduplicator.hpp"
+#include "FileIdentity.hpp"
+#include "FileReader.hpp"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+
+#include <cerrno>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#if defined(Q_OS_LINUX) && __has_include(<linux/fs.h>)
+#include <linux/fs.h>
+#include <sys/ioctl.h>
+#ifdef FIDEDUPERANGE
+#define DUFF_HAS_FIDEDUPERANGE
+#endif
+#endif
+
+namespace
+{
+	std::filesystem::path toPath(const QString& filePath)
+	{
+#ifdef Q_OS_WIN
+		return std::filesystem::path(filePath.toStdWString());
+#else
+		return std::filesystem::path(QFile::encodeName(filePath).toStdString());
+#endif
+	}
+
+#ifdef DUFF_HAS_FIDEDUPERANGE
+	class FileDescriptor
+	{
+	public:
+		explicit FileDescriptor(int fd) :
+			_fd(fd)
+		{
+		}
+
+		~FileDescriptor()
+		{
+			if (_fd >= 0)
+			{
+				close(_fd);
+			}
+		}
+
+		operator int() const
+		{
+			return _fd;
+		}
+
+	private:
+		const int _fd;
+	};
+
+	int openTarget(const QString& filePath)
+	{
+		const QByteArray fileName = QFile::encodeName(filePath);
+		const int fd = open(fileName.constData(), O_RDWR | O_CLOEXEC);
+
+		// Writable is required unless the caller owns the target
+		return fd >= 0 ? fd : open(fileName.constData(), O_RDONLY | O_CLOEXEC);
+	}
+#endif
+}
+
+Deduplicator::Deduplicator(QObject* parent) :
+	QThread(parent)
+{
+}
+
+Deduplicator::~Deduplicator()
+{
+	requestInterruption();
+	wait();
+}
+
+void Deduplicator::setGroups(const QList<QStringList>& groups)
+{
+	_groups = groups;
+}
+
+bool Deduplicator::keepRunning() const
+{
+	// Called from the worker threads too, hence not QThread::currentThread()
+	return isInterruptionRequested() == false;
+}
+
+Deduplicator::Result Deduplicator::shareExtents(const QString& source, const QString& target, QString& error) const
+{
+#ifdef DUFF_HAS_FIDEDUPERANGE
+	const FileDescriptor sourceFd(open(QFile::encodeName(source).constData(), O_RDONLY | O_CLOEXEC));
+
+	if (sourceFd < 0)
+	{
+		error = strerror(errno);
+		return Result::Failed;
+	}
+
+	const FileDescriptor targetFd(openTarget(target));
+
+	if (targetFd < 0)
+	{
+		error = strerror(errno);
+		return Result::Failed;
+	}
+
+	const qint64 size = QFileInfo(source).size();
+
+	// One destination, the request carries its info array inline
+	std::unique_ptr<char[]> buffer(new char[sizeof(file_dedupe_range) + sizeof(file_dedupe_range_info)]());
+	auto range = reinterpret_cast<file_dedupe_range*>(buffer.get());
+	file_dedupe_range_info& info = range->info[0];
+
+	for (qint64 offset = 0; offset < size && keepRunning();)
+	{
+		range->src_offset = offset;
+		range->src_length = qMin(DedupeChunkSize, size - offset);
+		range->dest_count = 1;
+		info.dest_fd = targetFd;
+		info.dest_offset = offset;
+		info.bytes_deduped = 0;
+		info.status = 0;
+
+		const int result = ioctl(sourceFd, FIDEDUPERANGE, range) < 0 ? errno : -info.status;
+
+		if (info.status == FILE_DEDUPE_RANGE_DIFFERS)
+		{
+			return Result::Differs;
+		}
+
+		if (result != 0)
+		{
+			error = strerror(result);
+
+			// Filesystems without extent sharing refuse the first request
+			const bool unsupported = result == EOPNOTSUPP || result == EINVAL || result == EXDEV || result == ENOTTY;
+			return offset == 0 && unsupported ? Result::Unsupported : Result::Failed;
+		}
+
+		if (info.bytes_deduped == 0)
+		{
+			error = "No progress";
+			return Result::Failed;
+		}
+
+		offset += info.bytes_deduped;
+	}
+
+	return Result::Shared;
+#else
+	Q_UNUSED(source);
+	Q_UNUSED(target);
+	Q_UNUSED(error);
+	return Result::Unsupported;
+#endif
+}
+
+Deduplicator::Result Deduplicator::hardlink(const QString& source, const QString& target, QString& error) const
+{
+	const std::optional<FileIdentity> sourceIdentity = FileIdentity::of(source);
+	const std::optional<FileIdentity> targetIdentity = FileIdentity::of(target);
+
+	if (!sourceIdentity || !targetIdentity)
+	{
+		error = "Could not stat";
+		return Result::Failed;
+	}
+
+	if (sourceIdentity->device == targetIdentity->device && sourceIdentity->inode == targetIdentity->inode)
+	{
+		return Result::Linked;
+	}
+
+	// The kernel does not verify anything here, so the bytes are compared first
+	if (!contentsEqual(source, target, error))
+	{
+		return error.isEmpty() ? Result::Differs : Result::Failed;
+	}
+
+	// Linked next to the target and renamed over it, so that the target path never disappears
+	const std::filesystem::path targetPath = toPath(target);
+	std::filesystem::path temporaryPath = targetPath;
+	temporaryPath += ".duff-link";
+
+	std::error_code code;
+	std::filesystem::create_hard_link(toPath(source), temporaryPath, code);
+
+	if (code)
+	{
+		error = QString::fromStdString(code.message());
+		return Result::Failed;
+	}
+
+	std::filesystem::rename(temporaryPath, targetPath, code);
+
+	if (code)
+	{
+		error = QString::fromStdString(code.message());
+		std::filesystem::remove(temporaryPath, code);
+		return Result::Failed;
+	}
+
+	return Result::Linked;
+}
+
+bool Deduplicator::contentsEqual(const QString& source, const QString& target, QString& error) const
+{
+	QFile sourceFile(source);
+	QFile targetFile(target);
+
+	if (!sourceFile.open(QIODevice::ReadOnly) || !targetFile.open(QIODevice::ReadOnly))
+	{
+		error = sourceFile.errorString() + targetFile.errorString();
+		return false;
+	}
+
+	if (sourceFile.size() != targetFile.size())
+	{
+		return false;
+	}
+
+	while (!sourceFile.atEnd() && keepRunning())
+	{
+		const QByteArray sourceBlock = sourceFile.read(FileReader::BlockSize);
+		const QByteArray targetBlock = targetFile.read(FileReader::BlockSize);
+
+		if (sourceBlock.isEmpty() || targetBlock.isEmpty())
+		{
+			error = "Read failed";
+			return false;
+		}
+
+		if (sourceBlock != targetBlock)
+		{
+			return false;
+		}
+	}
+
+	if (!keepRunning())
+	{
+		error = "Interrupted";
+		return false;
+	}
+
+	return true;
+}
+
+void Deduplicator::processGroups()
+{
+	for (qsizetype i = _next++; i < _groups.size() && keepRunning(); i = _next++)
+	{
+		const QStringList& group = _groups.at(i);
+		const QString& source = group.first();
+		const qint64 size = QFileInfo(source).size();
+
+		int shared = 0;
+		int linked = 0;
+		int differs = 0;
+		QStringList failures;
+		QStringList sharedPaths;
+
+		for (qsizetype j = 1; j < group.size() && keepRunning(); ++j)
+		{
+			const QString& target = group.at(j);
+			QString error;
+
+			Result result = shareExtents(source, target, error);
+
+			if (result == Result::Unsupported)
+			{
+				error.clear();
+				result = hardlink(source, target, error);
+			}
+
+			switch (result)
+			{
+				case Result::Shared:
+					++shared;
+					_bytesShared += size;
+					sharedPaths.append(target);
+					break;
+				case Result::Linked:
+					++linked;
+					_bytesShared += size;
+					sharedPaths.append(target);
+					break;
+				case Result::Differs:
+					++differs;
+					break;
+				case Result::Unsupported:
+				case Result::Failed:
+					failures.append(QString("    %1: %2").arg(target, error));
+					break;
+			}
+		}
+
+		const QString outcome =
+			QString("%1: %2 shared, %3 hard linked, %4 differ, %5 failed")
+				.arg(source)
+				.arg(shared)
+				.arg(linked)
+				.arg(differs)
+				.arg(failures.size());
+
+		const qsizetype processed = ++_processed;
+
+		QMutexLocker lock(&_mutex);
+		_report.append(outcome);
+		_report.append(failures);
+		_sharedPaths.append(sharedPaths);
+
+		if (!_progressTimer.isValid() || _progressTimer.elapsed() >= ProgressInterval)
+		{
+			_progressTimer.start();
+			emit progressed(processed, _groups.size());
+		}
+	}
+}
+
+void Deduplicator::run()
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	_next = 0;
+	_processed = 0;
+	_bytesShared = 0;
+	_report.clear();
+	_sharedPaths.clear();
+	_progressTimer.invalidate();
+
+	const int threadCount = qMin<qsizetype>(_pool.maxThreadCount(), _groups.size());
+
+	for (int i = 0; i < threadCount; ++i)
+	{
+		_pool.start(std::bind(&Deduplicator::processGroups, this));
+	}
+
+	_pool.waitForDone();
+
+	qDebug() << "Processed" << _processed << "of" << _groups.size() << "groups in"
+		<< timer.elapsed() << "ms," << _bytesShared << "bytes shared";
+
+	emit progressed(_processed, _groups.size());
+	emit deduplicated(_report, _sharedPaths, _bytesShared);
+}
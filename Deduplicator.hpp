@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QList>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+
+#include <atomic>
+
+// Makes identical files share their storage instead of deleting them, so that every path stays valid.
+// Where the filesystem supports it (btrfs, XFS) the kernel shares the extents with FIDEDUPERANGE
+// after comparing the bytes itself. Elsewhere the files are replaced by hard links to the source
+class Deduplicator : public QThread
+{
+	Q_OBJECT
+
+public:
+	Deduplicator(QObject* parent);
+	~Deduplicator();
+
+	// The first path of a group is the source, the rest are made to share its storage
+	void setGroups(const QList<QStringList>& groups);
+
+signals:
+	// Rate limited
+	void progressed(qsizetype processedGroups, qsizetype totalGroups);
+	// One outcome line per group. The shared paths are the targets which now share the storage of their source
+	void deduplicated(const QStringList& report, const QStringList& sharedPaths, qint64 bytesShared);
+
+private:
+	enum class Result
+	{
+		Shared,
+		Linked,
+		Differs,
+		Unsupported,
+		Failed
+	};
+
+	// Drivers cap the length of a single request, e.g. btrfs to 16M
+	static constexpr qint64 DedupeChunkSize = 0x1000000;
+	static constexpr qint64 ProgressInterval = 100; // Milliseconds
+
+	bool keepRunning() const;
+	Result shareExtents(const QString& source, const QString& target, QString& error) const;
+	Result hardlink(const QString& source, const QString& target, QString& error) const;
+	bool contentsEqual(const QString& source, const QString& target, QString& error) const;
+	void processGroups();
+	void run() override;
+
+	QThreadPool _pool;
+	QList<QStringList> _groups;
+	std::atomic<qsizetype> _next = 0;
+	std::atomic<qsizetype> _processed = 0;
+	std::atomic<qint64> _bytesShared = 0;
+	QMutex _mutex;
+	QStringList _report;
+	QStringList _sharedPaths;
+	QElapsedTimer _progressTimer;
+};
@@ -0,0 +1,269 @@
+#include "DirectoryWalker.hpp"
+
+#include <QDebug>
+#include <QDir>
+#include <QDateTime>
+#include <QFileInfo>
+#include <QFile>
+#include <QThreadPool>
+
+#if defined(Q_OS_LINUX)
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <cerrno>
+#include <cstring>
+#include <memory>
+#ifdef SYS_getdents64
+#define DUFF_HAS_GETDENTS64
+#endif
+#endif
+
+#ifdef DUFF_HAS_GETDENTS64
+namespace
+{
+	// Not exported by the C library headers
+	struct LinuxDirent64
+	{
+		quint64 d_ino;
+		qint64 d_off;
+		unsigned short d_reclen;
+		unsigned char d_type;
+		char d_name[];
+	};
+
+	class DirectoryDescriptor
+	{
+	public:
+		explicit DirectoryDescriptor(const QByteArray& path) :
+			_fd(open(path.constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC | O_NOFOLLOW))
+		{
+		}
+
+		~DirectoryDescriptor()
+		{
+			if (_fd >= 0)
+			{
+				close(_fd);
+			}
+		}
+
+		operator int() const
+		{
+			return _fd;
+		}
+
+	private:
+		const int _fd;
+	};
+}
+#endif
+
+DirectoryWalker::DirectoryWalker(const QString& root, const PathFilter& filter, int threadCount) :
+	_root(root),
+	_filter(filter),
+	_threadCount(qMax(1, threadCount))
+{
+}
+
+void DirectoryWalker::walk(const Visitor& visitor, const KeepRunning& keepRunning)
+{
+#ifdef DUFF_HAS_GETDENTS64
+	_pending = { QFile::encodeName(QDir::cleanPath(_root)) };
+	_busy = 0;
+
+	QThreadPool pool;
+	pool.setMaxThreadCount(_threadCount);
+
+	for (int i = 1; i < _threadCount; ++i)
+	{
+		pool.start(std::bind(&DirectoryWalker::walkDirectories, this, std::cref(visitor), std::cref(keepRunning)));
+	}
+
+	walkDirectories(visitor, keepRunning);
+	pool.waitForDone();
+#else
+	walkSerially(visitor, keepRunning);
+#endif
+}
+
+void DirectoryWalker::walkDirectories(const Visitor& visitor, const KeepRunning& keepRunning)
+{
+	QMutexLocker lock(&_mutex);
+
+	while (true)
+	{
+		// Idle walkers wait until a busy one finds more directories or everyone is idle
+		while (_pending.empty() && _busy > 0 && keepRunning())
+		{
+			_pendingChanged.wait(&_mutex, 100);
+		}
+
+		if (_pending.empty() || !keepRunning())
+		{
+			_pendingChanged.wakeAll();
+			return;
+		}
+
+		const QByteArray directory = std::move(_pending.back());
+		_pending.pop_back();
+		++_busy;
+
+		lock.unlock();
+		readDirectory(directory, visitor, keepRunning);
+		lock.relock();
+
+		--_busy;
+		_pendingChanged.wakeAll();
+	}
+}
+
+void DirectoryWalker::readDirectory(const QByteArray& directory, const Visitor& visitor, const KeepRunning& keepRunning)
+{
+#ifdef DUFF_HAS_GETDENTS64
+	const DirectoryDescriptor fd(directory);
+
+	if (fd < 0)
+	{
+		qDebug() << "Failed to open" << directory << strerror(errno);
+		return;
+	}
+
+	thread_local std::unique_ptr<char[]> buffer(new char[BufferSize]);
+	const QByteArray prefix = directory.endsWith('/') ? directory : directory + '/';
+	const QString prefixPath = QFile::decodeName(prefix);
+	std::vector<QByteArray> subdirectories;
+
+	while (keepRunning())
+	{
+		const long length = syscall(SYS_getdents64, int(fd), buffer.get(), BufferSize);
+
+		if (length <= 0)
+		{
+			if (length < 0)
+			{
+				qDebug() << "Failed to read" << directory << strerror(errno);
+			}
+
+			break;
+		}
+
+		for (long offset = 0; offset < length;)
+		{
+			const auto entry = reinterpret_cast<const LinuxDirent64*>(buffer.get() + offset);
+			offset += entry->d_reclen;
+
+			// Also skips "." and ".."
+			if (entry->d_name[0] == '.')
+			{
+				continue;
+			}
+
+			unsigned char type = entry->d_type;
+			struct stat status = {};
+			bool hasStatus = false;
+
+			// Not every filesystem fills in the type
+			if (type == DT_UNKNOWN)
+			{
+				if (fstatat(fd, entry->d_name, &status, AT_SYMLINK_NOFOLLOW) != 0)
+				{
+					continue;
+				}
+
+				type = S_ISDIR(status.st_mode) ? DT_DIR : S_ISREG(status.st_mode) ? DT_REG : S_ISLNK(status.st_mode) ? DT_LNK : DT_UNKNOWN;
+				hasStatus = type == DT_REG;
+			}
+
+			if (type == DT_DIR)
+			{
+				if (_filter.includesDirectory(QFile::decodeName(entry->d_name)))
+				{
+					subdirectories.emplace_back(prefix + entry->d_name);
+				}
+
+				continue;
+			}
+
+			if (type != DT_REG && type != DT_LNK)
+			{
+				continue;
+			}
+
+			const QString fileName = QFile::decodeName(entry->d_name);
+
+			if (!_filter.includesFileName(fileName))
+			{
+				continue;
+			}
+
+			// Links are followed to files, but never into directories
+			if (!hasStatus && (fstatat(fd, entry->d_name, &status, 0) != 0 || !S_ISREG(status.st_mode)))
+			{
+				continue;
+			}
+
+			if (!_filter.includesMetadata(qint64(status.st_size), qint64(status.st_mtim.tv_sec)))
+			{
+				continue;
+			}
+
+			visitor(prefixPath + fileName, FileIdentity::fromStatus(status));
+		}
+
+		// Handed out after each buffer, so that the other walkers get busy early on
+		if (!subdirectories.empty())
+		{
+			QMutexLocker lock(&_mutex);
+			std::move(subdirectories.begin(), subdirectories.end(), std::back_inserter(_pending));
+			subdirectories.clear();
+			_pendingChanged.wakeAll();
+		}
+	}
+#else
+	Q_UNUSED(directory);
+	Q_UNUSED(visitor);
+	Q_UNUSED(keepRunning);
+#endif
+}
+
+void DirectoryWalker::walkSerially(const Visitor& visitor, const KeepRunning& keepRunning)
+{
+	QStringList pending = { _root };
+
+	while (!pending.isEmpty() && keepRunning())
+	{
+		const QDir directory(pending.takeLast());
+		const QFileInfoList entries = directory.entryInfoList(QDir::Dirs | QDir::Files | QDir::NoDotAndDotDot);
+
+		for (const QFileInfo& entry : entries)
+		{
+			if (entry.isDir())
+			{
+				if (!entry.isSymLink() && _filter.includesDirectory(entry.fileName()))
+				{
+					pending.append(entry.filePath());
+				}
+
+				continue;
+			}
+
+			if (!_filter.includesFileName(entry.fileName()) ||
+				!_filter.includesMetadata(entry.size(), entry.lastModified().toSecsSinceEpoch()))
+			{
+				continue;
+			}
+
+			// QFileInfo does not tell the inode, so only the files of interest are asked for it
+			const QString filePath = QDir::toNativeSeparators(entry.filePath());
+			const std::optional<FileIdentity> identity = FileIdentity::of(filePath);
+
+			if (identity)
+			{
+				visitor(filePath, identity.value());
+			}
+		}
+	}
+}
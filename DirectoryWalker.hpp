@@ -0,0 +1,45 @@
+#pragma once
+
+#include <QByteArray>
+#include <QMutex>
+#include <QStringList>
+#include <QWaitCondition>
+
+#include "FileIdentity.hpp"
+#include "PathFilter.hpp"
+
+#include <functional>
+#include <vector>
+
+// Lists the regular files below a directory which pass the filter, hidden ones and symbolic links
+// to directories excluded. Directories excluded by the filter are not entered.
+// On Linux the directories are read with getdents64 by several threads at once, and an entry is only
+// stat'ed when it is a file of interest or its type is not known from the directory entry itself.
+// Elsewhere QDir does the work.
+class DirectoryWalker
+{
+public:
+	// Called from the walking threads concurrently, with the identity the walk stat'ed anyway
+	using Visitor = std::function<void(const QString& filePath, const FileIdentity& identity)>;
+	using KeepRunning = std::function<bool()>;
+
+	DirectoryWalker(const QString& root, const PathFilter& filter, int threadCount);
+
+	void walk(const Visitor& visitor, const KeepRunning& keepRunning);
+
+private:
+	void walkDirectories(const Visitor& visitor, const KeepRunning& keepRunning);
+	void readDirectory(const QByteArray& directory, const Visitor& visitor, const KeepRunning& keepRunning);
+	void walkSerially(const Visitor& visitor, const KeepRunning& keepRunning);
+
+	static constexpr int BufferSize = 0x40000; // 256K, many entries per system call
+
+	const QString _root;
+	const PathFilter& _filter;
+	const int _threadCount;
+
+	QMutex _mutex;
+	QWaitCondition _pendingChanged;
+	std::vector<QByteArray> _pending;
+	int _busy = 0;
+};
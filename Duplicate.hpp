@@ -0,0 +1,19 @@
+#pragma once
+
+#include <QList>
+#include <QMetaType>
+#include <QString>
+
+// A path found to share its content with another path
+struct Duplicate
+{
+	// The content hash, or for paths of one inode, e.g. hard links, the device and inode
+	QString hash;
+	QString filePath;
+	qint64 size = 0;
+	bool hardlink = false;
+};
+
+using DuplicateList = QList<Duplicate>;
+
+Q_DECLARE_METATYPE(Duplicate)
@@ -0,0 +1,170 @@
+#include "FastHash.hpp"
+
+#include <QtEndian>
+#include <algorithm>
+#include <cstring>
+
+namespace
+{
+	constexpr quint64 Prime32_1 = 0x9E3779B1ULL;
+	constexpr quint64 Prime64_1 = 0x9E3779B185EBCA87ULL;
+	constexpr quint64 Prime64_2 = 0xC2B2AE3D27D4EB4FULL;
+	constexpr quint64 Prime64_3 = 0x165667B19E3779F9ULL;
+
+	// Arbitrary but fixed key material, one word per lane and stripe offset
+	constexpr std::array<quint64, 24> Secret =
+	{
+		0xBE4BA423396CFEB8ULL, 0x1CAD21F72C81017CULL, 0xDB979083E96DD4DEULL, 0x1F67B3B7A4A44072ULL,
+		0x78E5C0CC4EE679CBULL, 0x2172FFCC7DD05A82ULL, 0x8E2443F7744608B8ULL, 0x4C263A81E69035E0ULL,
+		0xCB00C391BB52283CULL, 0xA32E531B8B65D088ULL, 0x4EF90DA297486471ULL, 0xD8ACDEA946EF1938ULL,
+		0x3F349CE33F76FAA8ULL, 0x1D4F0BC7C7BBDCF9ULL, 0x3159B4CD4BE0518AULL, 0x647378D9C97E9FC8ULL,
+		0xC3EBD33483ACC5EAULL, 0xEB6313FAFFA081C5ULL, 0x49DAF0B751DD0D17ULL, 0x9E68D429265516D3ULL,
+		0xFCA1477D58BE162BULL, 0xCE31D07AD1B8F88FULL, 0x280416958F3ACB45ULL, 0x7E404BBBCAFBD7AFULL
+	};
+
+	quint64 readWord(const uchar* data)
+	{
+		return qFromLittleEndian<quint64>(data);
+	}
+
+	// Multiplies into 128 bits and folds the halves together
+	quint64 multiplyFold(quint64 lhs, quint64 rhs)
+	{
+#if defined(__SIZEOF_INT128__)
+		const unsigned __int128 product = static_cast<unsigned __int128>(lhs) * rhs;
+		return static_cast<quint64>(product) ^ static_cast<quint64>(product >> 64);
+#else
+		const quint64 lhsLow = lhs & 0xFFFFFFFF;
+		const quint64 lhsHigh = lhs >> 32;
+		const quint64 rhsLow = rhs & 0xFFFFFFFF;
+		const quint64 rhsHigh = rhs >> 32;
+
+		const quint64 lowLow = lhsLow * rhsLow;
+		const quint64 highLow = lhsHigh * rhsLow;
+		const quint64 lowHigh = lhsLow * rhsHigh;
+		const quint64 highHigh = lhsHigh * rhsHigh;
+
+		const quint64 cross = (lowLow >> 32) + (highLow & 0xFFFFFFFF) + lowHigh;
+		const quint64 upper = (highLow >> 32) + (cross >> 32) + highHigh;
+		const quint64 lower = (cross << 32) | (lowLow & 0xFFFFFFFF);
+		return lower ^ upper;
+#endif
+	}
+
+	quint64 avalanche(quint64 value)
+	{
+		value ^= value >> 37;
+		value *= 0x165667919E3779F9ULL;
+		value ^= value >> 32;
+		return value;
+	}
+}
+
+FastHash::FastHash()
+{
+	reset();
+}
+
+void FastHash::reset()
+{
+	_accumulators =
+	{
+		Prime32_1, Prime64_1, Prime64_2, Prime64_3,
+		~Prime32_1, ~Prime64_1, ~Prime64_2, ~Prime64_3
+	};
+
+	_bufferSize = 0;
+	_stripe = 0;
+	_length = 0;
+}
+
+void FastHash::accumulate(const uchar* stripe)
+{
+	const quint64* key = Secret.data() + _stripe;
+
+	// Kept branch free and lane independent so that it vectorizes
+	for (int lane = 0; lane < Lanes; ++lane)
+	{
+		const quint64 value = readWord(stripe + lane * sizeof(quint64));
+		const quint64 keyed = value ^ key[lane];
+		_accumulators[lane ^ 1] += value;
+		_accumulators[lane] += (keyed & 0xFFFFFFFF) * (keyed >> 32);
+	}
+
+	if (++_stripe == StripesPerBlock)
+	{
+		for (int lane = 0; lane < Lanes; ++lane)
+		{
+			quint64 accumulator = _accumulators[lane];
+			accumulator ^= accumulator >> 47;
+			accumulator ^= Secret[Secret.size() - Lanes + lane];
+			_accumulators[lane] = accumulator * Prime32_1;
+		}
+
+		_stripe = 0;
+	}
+}
+
+void FastHash::addData(const char* data, qint64 length)
+{
+	const uchar* input = reinterpret_cast<const uchar*>(data);
+	_length += length;
+
+	if (_bufferSize > 0)
+	{
+		const qint64 missing = qMin<qint64>(StripeSize - _bufferSize, length);
+		std::memcpy(_buffer.data() + _bufferSize, input, missing);
+		_bufferSize += missing;
+		input += missing;
+		length -= missing;
+
+		if (_bufferSize < StripeSize)
+		{
+			return;
+		}
+
+		accumulate(_buffer.data());
+		_bufferSize = 0;
+	}
+
+	while (length >= StripeSize)
+	{
+		accumulate(input);
+		input += StripeSize;
+		length -= StripeSize;
+	}
+
+	std::memcpy(_buffer.data(), input, length);
+	_bufferSize = static_cast<int>(length);
+}
+
+QByteArray FastHash::result() const
+{
+	FastHash copy = *this;
+
+	// The zero padding is disambiguated by mixing in the total length
+	if (copy._bufferSize > 0)
+	{
+		std::fill(copy._buffer.begin() + copy._bufferSize, copy._buffer.end(), uchar(0));
+		copy.accumulate(copy._buffer.data());
+	}
+
+	const std::array<quint64, Lanes>& acc = copy._accumulators;
+
+	quint64 low = _length * Prime64_1;
+	low += multiplyFold(acc[0] ^ Secret[1], acc[1] ^ Secret[2]);
+	low += multiplyFold(acc[2] ^ Secret[3], acc[3] ^ Secret[4]);
+	low += multiplyFold(acc[4] ^ Secret[5], acc[5] ^ Secret[6]);
+	low += multiplyFold(acc[6] ^ Secret[7], acc[7] ^ Secret[8]);
+
+	quint64 high = ~_length * Prime64_2;
+	high += multiplyFold(acc[0] ^ Secret[11], acc[1] ^ Secret[12]);
+	high += multiplyFold(acc[2] ^ Secret[13], acc[3] ^ Secret[14]);
+	high += multiplyFold(acc[4] ^ Secret[15], acc[5] ^ Secret[16]);
+	high += multiplyFold(acc[6] ^ Secret[17], acc[7] ^ Secret[18]);
+
+	QByteArray digest(DigestSize, Qt::Uninitialized);
+	qToBigEndian<quint64>(avalanche(high), digest.data());
+	qToBigEndian<quint64>(avalanche(low), digest.data() + sizeof(quint64));
+	return digest;
+}
@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QByteArray>
+#include <array>
+
+// A non-cryptographic 128-bit digest in the spirit of XXH3.
+// Eight independent 64-bit lanes are fed with 32 x 32 -> 64 bit multiplies,
+// which compilers turn into SIMD code, so hashing runs close to memory speed.
+// The digest is NOT compatible with the reference XXH3 implementation.
+class FastHash
+{
+public:
+	FastHash();
+
+	void reset();
+	void addData(const char* data, qint64 length);
+	QByteArray result() const;
+
+	static constexpr int DigestSize = 16;
+
+private:
+	static constexpr int Lanes = 8;
+	static constexpr int StripeSize = Lanes * sizeof(quint64);
+	static constexpr int StripesPerBlock = 16;
+
+	void accumulate(const uchar* stripe);
+
+	std::array<quint64, Lanes> _accumulators;
+	std::array<uchar, StripeSize> _buffer;
+	int _bufferSize = 0;
+	int _stripe = 0;
+	quint64 _length = 0;
+};
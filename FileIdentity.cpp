@@ -0,0 +1,73 @@
+#include "FileIdentity.hpp"
+
+#include <QFile>
+
+#ifdef Q_OS_WIN
+#include <Windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+std::optional<FileIdentity> FileIdentity::of(const QString& filePath)
+{
+	FileIdentity identity;
+
+#ifdef Q_OS_WIN
+	const HANDLE file = CreateFileW(
+		reinterpret_cast<LPCWSTR>(filePath.utf16()),
+		FILE_READ_ATTRIBUTES,
+		FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+		nullptr,
+		OPEN_EXISTING,
+		FILE_FLAG_BACKUP_SEMANTICS,
+		nullptr);
+
+	if (file == INVALID_HANDLE_VALUE)
+	{
+		return std::nullopt;
+	}
+
+	BY_HANDLE_FILE_INFORMATION information = {};
+	const BOOL success = GetFileInformationByHandle(file, &information);
+	CloseHandle(file);
+
+	if (!success)
+	{
+		return std::nullopt;
+	}
+
+	identity.device = information.dwVolumeSerialNumber;
+	identity.inode = (quint64(information.nFileIndexHigh) << 32) | information.nFileIndexLow;
+	identity.size = (qint64(information.nFileSizeHigh) << 32) | information.nFileSizeLow;
+	identity.modified = (qint64(information.ftLastWriteTime.dwHighDateTime) << 32) | information.ftLastWriteTime.dwLowDateTime;
+	identity.links = information.nNumberOfLinks;
+#else
+	struct stat status = {};
+
+	if (stat(QFile::encodeName(filePath).constData(), &status) != 0)
+	{
+		return std::nullopt;
+	}
+
+	identity = fromStatus(status);
+#endif
+
+	return identity;
+}
+
+#ifndef Q_OS_WIN
+FileIdentity FileIdentity::fromStatus(const struct stat& status)
+{
+	FileIdentity identity;
+	identity.device = static_cast<quint64>(status.st_dev);
+	identity.inode = static_cast<quint64>(status.st_ino);
+	identity.size = static_cast<qint64>(status.st_size);
+#ifdef Q_OS_DARWIN
+	identity.modified = qint64(status.st_mtimespec.tv_sec) * 1000000000 + status.st_mtimespec.tv_nsec;
+#else
+	identity.modified = qint64(status.st_mtim.tv_sec) * 1000000000 + status.st_mtim.tv_nsec;
+#endif
+	identity.links = static_cast<quint64>(status.st_nlink);
+	return identity;
+}
+#endif
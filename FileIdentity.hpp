@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QString>
+#include <optional>
+
+#ifndef Q_OS_WIN
+struct stat;
+#endif
+
+// What identifies a file and its content version without reading it
+struct FileIdentity
+{
+	quint64 device = 0;
+	quint64 inode = 0;
+	qint64 size = 0;
+	qint64 modified = 0; // In platform specific units, only compared for equality
+	quint64 links = 0;
+
+	static std::optional<FileIdentity> of(const QString& filePath);
+#ifndef Q_OS_WIN
+	// Of a file stat'ed already, e.g. while listing its directory
+	static FileIdentity fromStatus(const struct stat& status);
+#endif
+};
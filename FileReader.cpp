@@ -0,0 +1,406 @@
+#include "FileReader.hpp"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <memory>
+#include <new>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#endif
+
+#if defined(Q_OS_LINUX) || defined(Q_OS_FREEBSD)
+#define DUFF_HAS_FADVISE
+#endif
+
+#ifdef Q_OS_LINUX
+#define DUFF_HAS_O_DIRECT
+#define DUFF_HAS_MINCORE
+#endif
+
+namespace
+{
+	// Satisfies the alignment requirements of O_DIRECT on any common device
+	constexpr qint64 Alignment = 0x1000; // 4K
+
+	struct AlignedDeleter
+	{
+		void operator()(char* buffer) const
+		{
+			::operator delete[](buffer, std::align_val_t(Alignment));
+		}
+	};
+
+	char* blockBuffer()
+	{
+		thread_local std::unique_ptr<char[], AlignedDeleter> buffer(
+			static_cast<char*>(::operator new[](FileReader::BlockSize, std::align_val_t(Alignment))));
+
+		return buffer.get();
+	}
+
+	void adviseSequential([[maybe_unused]] int descriptor, [[maybe_unused]] qint64 offset, [[maybe_unused]] qint64 length)
+	{
+#ifdef DUFF_HAS_FADVISE
+		posix_fadvise(descriptor, offset, length, POSIX_FADV_SEQUENTIAL);
+#endif
+	}
+
+	void adviseDontNeed([[maybe_unused]] int descriptor, [[maybe_unused]] qint64 offset, [[maybe_unused]] qint64 length)
+	{
+#ifdef DUFF_HAS_FADVISE
+		posix_fadvise(descriptor, offset, length, POSIX_FADV_DONTNEED);
+#endif
+	}
+
+	// Which pages of the range are in the page cache, one byte per page. Empty if unknown
+	std::vector<unsigned char> residentPages([[maybe_unused]] int descriptor, [[maybe_unused]] qint64 offset, [[maybe_unused]] qint64 length)
+	{
+#if defined(DUFF_HAS_MINCORE) && defined(DUFF_HAS_FADVISE)
+		const qint64 pageSize = sysconf(_SC_PAGESIZE);
+		const qint64 first = offset - offset % pageSize;
+		const size_t mappedLength = size_t(offset + length - first);
+
+		// Mapping without touching the pages does not fault them in
+		void* memory = mmap(nullptr, mappedLength, PROT_READ, MAP_SHARED, descriptor, first);
+
+		if (memory == MAP_FAILED)
+		{
+			return {};
+		}
+
+		std::vector<unsigned char> pages((mappedLength + pageSize - 1) / pageSize);
+
+		if (mincore(memory, mappedLength, pages.data()) != 0)
+		{
+			pages.clear();
+		}
+
+		munmap(memory, mappedLength);
+		return pages;
+#else
+		return {};
+#endif
+	}
+
+	// Drops the pages of the range which were not resident before it was read
+	void dropFaultedPages(
+		[[maybe_unused]] int descriptor,
+		[[maybe_unused]] qint64 offset,
+		[[maybe_unused]] const std::vector<unsigned char>& resident)
+	{
+#if defined(DUFF_HAS_MINCORE) && defined(DUFF_HAS_FADVISE)
+		if (resident.empty())
+		{
+			return;
+		}
+
+		const qint64 pageSize = sysconf(_SC_PAGESIZE);
+		const qint64 first = offset - offset % pageSize;
+
+		for (size_t i = 0; i < resident.size();)
+		{
+			if (resident[i] & 1)
+			{
+				++i;
+				continue;
+			}
+
+			size_t j = i + 1;
+
+			while (j < resident.size() && !(resident[j] & 1))
+			{
+				++j;
+			}
+
+			adviseDontNeed(descriptor, first + qint64(i) * pageSize, qint64(j - i) * pageSize);
+			i = j;
+		}
+#endif
+	}
+}
+
+FileReader::FileReader(const QString& filePath, Mode mode) :
+	_mode(mode),
+	_file(filePath)
+{
+	if (_mode == Mode::Asynchronous)
+	{
+		_mode = Mode::Buffered;
+	}
+
+#ifndef DUFF_HAS_O_DIRECT
+	if (_mode == Mode::Direct)
+	{
+		_mode = Mode::Buffered;
+	}
+#endif
+}
+
+FileReader::~FileReader()
+{
+#ifdef DUFF_HAS_O_DIRECT
+	if (_descriptor >= 0)
+	{
+		::close(_descriptor);
+	}
+#endif
+}
+
+bool FileReader::open()
+{
+#ifdef DUFF_HAS_O_DIRECT
+	if (_mode == Mode::Direct)
+	{
+		const QByteArray nativePath = QFile::encodeName(_file.fileName());
+		_descriptor = ::open(nativePath.constData(), O_RDONLY | O_DIRECT | O_CLOEXEC);
+
+		// Some file systems, e.g. tmpfs, refuse O_DIRECT
+		if (_descriptor < 0 && errno == EINVAL)
+		{
+			qDebug() << "O_DIRECT not supported for" << _file.fileName();
+			_mode = Mode::Buffered;
+			return open();
+		}
+
+		struct stat status = {};
+
+		if (_descriptor < 0 || fstat(_descriptor, &status) != 0)
+		{
+			return false;
+		}
+
+		_size = status.st_size;
+		return true;
+	}
+#endif
+
+	// Unbuffered only skips QFile's own buffer, the reads still go through the page cache
+	if (!_file.open(QFile::ReadOnly | QFile::Unbuffered))
+	{
+		return false;
+	}
+
+	_size = _file.size();
+	return true;
+}
+
+qint64 FileReader::size() const
+{
+	return _size;
+}
+
+void FileReader::setDropBehind(bool enabled)
+{
+	_dropBehind = enabled;
+}
+
+bool FileReader::read(qint64 offset, qint64 length, const Consumer& consumer)
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	bool result = false;
+
+	switch (_mode)
+	{
+		case Mode::Buffered:
+		case Mode::Asynchronous:
+			result = readBuffered(offset, length, consumer);
+			break;
+		case Mode::MemoryMapped:
+			result = readMapped(offset, length, consumer);
+			break;
+		case Mode::Direct:
+			result = readDirect(offset, length, consumer);
+			break;
+	}
+
+	_readTime += timer.nsecsElapsed();
+	return result;
+}
+
+qint64 FileReader::bytesRead() const
+{
+	return _bytesRead;
+}
+
+qint64 FileReader::readTime() const
+{
+	return _readTime;
+}
+
+QString FileReader::name(Mode mode)
+{
+	switch (mode)
+	{
+		case Mode::Buffered:
+			return "buffered";
+		case Mode::MemoryMapped:
+			return "mmap";
+		case Mode::Direct:
+			return "direct";
+		case Mode::Asynchronous:
+			return "uring";
+	}
+
+	return "unknown";
+}
+
+std::optional<FileReader::Mode> FileReader::modeByName(const QString& name)
+{
+	for (Mode mode : { Mode::Buffered, Mode::MemoryMapped, Mode::Direct, Mode::Asynchronous })
+	{
+		if (FileReader::name(mode).compare(name, Qt::CaseInsensitive) == 0)
+		{
+			return mode;
+		}
+	}
+
+	return std::nullopt;
+}
+
+bool FileReader::readBuffered(qint64 offset, qint64 length, const Consumer& consumer)
+{
+	if (!_file.seek(offset))
+	{
+		return false;
+	}
+
+	if (length > BlockSize)
+	{
+		adviseSequential(_file.handle(), offset, length);
+	}
+
+	// Pages cached before belong to someone else, or to an earlier pass which may read them again
+	const std::vector<unsigned char> resident = _dropBehind && length > 0 ?
+		residentPages(_file.handle(), offset, length) :
+		std::vector<unsigned char>();
+
+	char* buffer = blockBuffer();
+	qint64 remaining = length;
+
+	while (remaining > 0)
+	{
+		const qint64 bytesRead = _file.read(buffer, qMin(remaining, BlockSize));
+
+		// Zero means the file has shrunk since it was opened
+		if (bytesRead <= 0)
+		{
+			return false;
+		}
+
+		_bytesRead += bytesRead;
+		remaining -= bytesRead;
+
+		if (!consumer(buffer, bytesRead))
+		{
+			return false;
+		}
+	}
+
+	// Keep a large scan from evicting everything else from the page cache
+	dropFaultedPages(_file.handle(), offset, resident);
+	return true;
+}
+
+bool FileReader::readMapped(qint64 offset, qint64 length, const Consumer& consumer)
+{
+	if (offset + length > _size)
+	{
+		return false;
+	}
+
+	uchar* memory = _file.map(offset, length);
+
+	if (!memory)
+	{
+		return false;
+	}
+
+#ifdef Q_OS_UNIX
+	const quintptr pageSize = static_cast<quintptr>(sysconf(_SC_PAGESIZE));
+	const quintptr address = reinterpret_cast<quintptr>(memory);
+	const quintptr pageAddress = address & ~(pageSize - 1);
+	madvise(reinterpret_cast<void*>(pageAddress), length + (address - pageAddress), MADV_SEQUENTIAL);
+#endif
+
+	const char* data = reinterpret_cast<const char*>(memory);
+	bool result = true;
+
+	for (qint64 position = 0; position < length; position += BlockSize)
+	{
+		const qint64 blockLength = qMin(length - position, BlockSize);
+		_bytesRead += blockLength;
+
+		if (!consumer(data + position, blockLength))
+		{
+			result = false;
+			break;
+		}
+	}
+
+	_file.unmap(memory);
+	return result;
+}
+
+bool FileReader::readDirect(
+	[[maybe_unused]] qint64 offset,
+	[[maybe_unused]] qint64 length,
+	[[maybe_unused]] const Consumer& consumer)
+{
+#ifdef DUFF_HAS_O_DIRECT
+	char* buffer = blockBuffer();
+	const qint64 end = offset + length;
+
+	// O_DIRECT requires aligned offsets, so read around the range and hand out only the range
+	qint64 position = offset - offset % Alignment;
+
+	while (position < end)
+	{
+		const ssize_t bytesRead = ::pread(_descriptor, buffer, BlockSize, position);
+
+		if (bytesRead < 0 && errno == EINTR)
+		{
+			continue;
+		}
+
+		if (bytesRead <= 0)
+		{
+			return false;
+		}
+
+		const qint64 first = qMax(offset, position);
+		const qint64 last = qMin(end, position + bytesRead);
+
+		if (last <= first)
+		{
+			return false;
+		}
+
+		_bytesRead += bytesRead;
+
+		if (!consumer(buffer + (first - position), last - first))
+		{
+			return false;
+		}
+
+		position += bytesRead;
+
+		// A short read means the end of the file, anything beyond it is missing
+		if (bytesRead < BlockSize && position < end)
+		{
+			return false;
+		}
+	}
+
+	return true;
+#else
+	return false;
+#endif
+}
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QFile>
+#include <QString>
+#include <functional>
+#include <optional>
+
+// Reads a file in blocks through one of several I/O strategies
+class FileReader
+{
+public:
+	enum class Mode : char
+	{
+		// Page cache reads, advised as sequential
+		Buffered,
+		// Memory mapped reads, advised as sequential
+		MemoryMapped,
+		// Reads bypassing the page cache, where supported
+		Direct,
+		// Whole files are read in batches through io_uring, see UringReader.
+		// Anything else is read buffered.
+		Asynchronous
+	};
+
+	// Receives the data block by block. Returning false stops the read.
+	using Consumer = std::function<bool(const char* data, qint64 length)>;
+
+	FileReader(const QString& filePath, Mode mode);
+	~FileReader();
+
+	bool open();
+	qint64 size() const;
+
+	// Buffered reads drop the pages they brought into the page cache once consumed.
+	// Pages cached before are left alone. Meant for the last pass over a file.
+	void setDropBehind(bool enabled);
+
+	// Returns false if the range could not be read entirely or the consumer stopped
+	bool read(qint64 offset, qint64 length, const Consumer& consumer);
+
+	qint64 bytesRead() const;
+	qint64 readTime() const;
+
+	// The names the command line and the benchmark accept
+	static QString name(Mode mode);
+	static std::optional<Mode> modeByName(const QString& name);
+
+	static constexpr qint64 BlockSize = 0x10000; // 64K
+
+private:
+	bool readBuffered(qint64 offset, qint64 length, const Consumer& consumer);
+	bool readMapped(qint64 offset, qint64 length, const Consumer& consumer);
+	bool readDirect(qint64 offset, qint64 length, const Consumer& consumer);
+
+	Mode _mode;
+	QFile _file;
+	int _descriptor = -1;
+	qint64 _size = 0;
+	bool _dropBehind = false;
+	qint64 _bytesRead = 0;
+	qint64 _readTime = 0;
+};
@@ -0,0 +1,133 @@
+#include "FileRemover.hpp"
+
+#include <QDebug>
+#include <QFile>
+#include <QFileInfo>
+
+FileRemover::FileRemover(QObject* parent) :
+	QThread(parent)
+{
+}
+
+FileRemover::~FileRemover()
+{
+	requestInterruption();
+	wait();
+}
+
+void FileRemover::setPaths(const QStringList& filePaths)
+{
+	_filePaths = filePaths;
+}
+
+qsizetype FileRemover::pathCount() const
+{
+	return _filePaths.size();
+}
+
+qsizetype FileRemover::processedCount() const
+{
+	return _processed;
+}
+
+bool FileRemover::keepRunning() const
+{
+	// Called from the worker threads too, hence not QThread::currentThread()
+	return isInterruptionRequested() == false;
+}
+
+void FileRemover::removeFiles()
+{
+	for (qsizetype i = _next++; i < _filePaths.size() && keepRunning(); i = _next++)
+	{
+		const QString& filePath = _filePaths.at(i);
+		QFile file(filePath);
+
+		// A file which does not exist anymore is as good as removed
+		if (file.remove() || !QFileInfo::exists(filePath))
+		{
+			report(filePath);
+		}
+		else
+		{
+			QMutexLocker lock(&_mutex);
+			_failures.append(filePath + ": " + file.errorString());
+		}
+
+		++_processed;
+	}
+}
+
+void FileRemover::report(const QString& filePath)
+{
+	QStringList batch;
+
+	{
+		QMutexLocker lock(&_mutex);
+		_batch.append(filePath);
+
+		if (_batch.size() < BatchSize && _batchTimer.isValid() && _batchTimer.elapsed() < BatchInterval)
+		{
+			return;
+		}
+
+		batch.swap(_batch);
+		_batchTimer.start();
+	}
+
+	emit filesRemoved(batch);
+}
+
+void FileRemover::flush()
+{
+	QStringList batch;
+
+	{
+		QMutexLocker lock(&_mutex);
+		batch.swap(_batch);
+		_batchTimer.start();
+	}
+
+	if (!batch.isEmpty())
+	{
+		emit filesRemoved(batch);
+	}
+}
+
+void FileRemover::waitForDone()
+{
+	// A batch is otherwise only sent when the next file is removed
+	while (!_pool.waitForDone(int(BatchInterval)))
+	{
+		flush();
+	}
+}
+
+void FileRemover::run()
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	_next = 0;
+	_processed = 0;
+	_failures.clear();
+	flush();
+
+	const int threadCount = qMin<qsizetype>(_pool.maxThreadCount(), _filePaths.size());
+
+	for (int i = 0; i < threadCount; ++i)
+	{
+		_pool.start(std::bind(&FileRemover::removeFiles, this));
+	}
+
+	waitForDone();
+	flush();
+
+	qDebug() << "Processed" << _processed << "of" << _filePaths.size() << "files in"
+		<< timer.elapsed() << "ms," << _failures.size() << "failed";
+
+	if (!_failures.isEmpty())
+	{
+		emit removalFailed(_failures);
+	}
+}
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <QElapsedTimer>
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+
+#include <atomic>
+
+// Deletes files from a thread pool. The removed paths are reported in batches
+// and the failures once at the end, so that nothing waits for the user in between
+class FileRemover : public QThread
+{
+	Q_OBJECT
+
+public:
+	FileRemover(QObject* parent);
+	~FileRemover();
+
+	void setPaths(const QStringList& filePaths);
+	qsizetype pathCount() const;
+
+	// Thread safe, the number of paths handled so far
+	qsizetype processedCount() const;
+
+signals:
+	// Includes the paths which did not exist anymore
+	void filesRemoved(const QStringList& filePaths);
+	// One line per file which could not be removed
+	void removalFailed(const QStringList& failures);
+
+private:
+	static constexpr qsizetype BatchSize = 0x400;
+	static constexpr qint64 BatchInterval = 100; // Milliseconds
+
+	bool keepRunning() const;
+	void removeFiles();
+	void report(const QString& filePath);
+	void flush();
+	void waitForDone();
+	void run() override;
+
+	QThreadPool _pool;
+	QStringList _filePaths;
+	std::atomic<qsizetype> _next = 0;
+	std::atomic<qsizetype> _processed = 0;
+	QMutex _mutex;
+	QStringList _batch;
+	QElapsedTimer _batchTimer;
+	QStringList _failures;
+};
@@ -0,0 +1,262 @@
+#include "HashCache.hpp"
+
+#include <QDataStream>
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QFileInfo>
+#include <QSaveFile>
+#include <QStandardPaths>
+
+namespace
+{
+	constexpr quint32 Magic = 0x44554643; // DUFC
+	constexpr quint32 Version = 1;
+
+	// Files not seen by any scan for this long are dropped
+	constexpr qint64 MaximumAge = 90 * 24 * 60 * 60;
+
+	qint64 now()
+	{
+		return QDateTime::currentSecsSinceEpoch();
+	}
+}
+
+HashCache::HashCache(Hasher::Algorithm algorithm) :
+	_algorithm(algorithm)
+{
+}
+
+Hasher::Algorithm HashCache::algorithm() const
+{
+	return _algorithm;
+}
+
+QString HashCache::filePath() const
+{
+	const QString directory = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+	return QDir(directory).filePath(QString("hashes-%1.dat").arg(Hasher::name(_algorithm)));
+}
+
+bool HashCache::load()
+{
+	QMutexLocker lock(&_mutex);
+	QFile file(filePath());
+
+	if (!file.exists())
+	{
+		return true;
+	}
+
+	if (!file.open(QFile::ReadOnly))
+	{
+		qWarning() << "Failed to open" << file.fileName();
+		return false;
+	}
+
+	QDataStream stream(&file);
+	quint32 magic = 0;
+	quint32 version = 0;
+	qint64 count = 0;
+
+	stream >> magic >> version >> count;
+
+	if (magic != Magic || version != Version || count < 0)
+	{
+		qWarning() << "Ignoring incompatible cache" << file.fileName();
+		return false;
+	}
+
+	_entries.clear();
+	_entries.reserve(count);
+
+	for (qint64 i = 0; i < count && stream.status() == QDataStream::Ok; ++i)
+	{
+		Key key;
+		Entry entry;
+
+		stream >> key.first >> key.second
+			>> entry.size >> entry.modified >> entry.lastSeen >> entry.sampleCount
+			>> entry.partialHash >> entry.fullHash;
+
+		_entries.insert(key, entry);
+	}
+
+	if (stream.status() != QDataStream::Ok)
+	{
+		qWarning() << "Ignoring truncated cache" << file.fileName();
+		_entries.clear();
+		return false;
+	}
+
+	_modified = false;
+	qDebug() << "Loaded" << _entries.size() << "cached hashes from" << file.fileName();
+	return true;
+}
+
+bool HashCache::save()
+{
+	QMutexLocker lock(&_mutex);
+
+	const qint64 oldest = now() - MaximumAge;
+
+	for (auto it = _entries.begin(); it != _entries.end();)
+	{
+		if (it->lastSeen < oldest)
+		{
+			it = _entries.erase(it);
+			_modified = true;
+			++_evictions;
+		}
+		else
+		{
+			++it;
+		}
+	}
+
+	if (!_modified)
+	{
+		return true;
+	}
+
+	const QString path = filePath();
+	QDir().mkpath(QFileInfo(path).path());
+
+	// Written aside and renamed, so an interrupted save keeps the previous cache
+	QSaveFile file(path);
+
+	if (!file.open(QFile::WriteOnly))
+	{
+		qWarning() << "Failed to open" << path;
+		return false;
+	}
+
+	QDataStream stream(&file);
+	stream << Magic << Version << qint64(_entries.size());
+
+	for (auto it = _entries.cbegin(); it != _entries.cend(); ++it)
+	{
+		const Entry& entry = it.value();
+
+		stream << it.key().first << it.key().second
+			<< entry.size << entry.modified << entry.lastSeen << entry.sampleCount
+			<< entry.partialHash << entry.fullHash;
+	}
+
+	if (stream.status() != QDataStream::Ok || !file.commit())
+	{
+		qWarning() << "Failed to write" << path;
+		return false;
+	}
+
+	_modified = false;
+	qDebug() << "Saved" << _entries.size() << "cached hashes to" << path;
+	return true;
+}
+
+HashCache::Entry* HashCache::find(const FileIdentity& identity)
+{
+	auto it = _entries.find({ identity.device, identity.inode });
+
+	if (it == _entries.end())
+	{
+		return nullptr;
+	}
+
+	if (it->size != identity.size || it->modified != identity.modified)
+	{
+		_entries.erase(it);
+		_modified = true;
+		++_evictions;
+		return nullptr;
+	}
+
+	return &it.value();
+}
+
+HashCache::Entry& HashCache::insert(const FileIdentity& identity)
+{
+	Entry* entry = find(identity);
+
+	if (!entry)
+	{
+		entry = &_entries[{ identity.device, identity.inode }];
+		entry->size = identity.size;
+		entry->modified = identity.modified;
+	}
+
+	entry->lastSeen = now();
+	_modified = true;
+	return *entry;
+}
+
+QByteArray HashCache::partialHash(const FileIdentity& identity, int sampleCount)
+{
+	QMutexLocker lock(&_mutex);
+	Entry* entry = find(identity);
+
+	if (!entry || entry->partialHash.isEmpty() || entry->sampleCount != sampleCount)
+	{
+		++_misses;
+		return {};
+	}
+
+	++_hits;
+	entry->lastSeen = now();
+	_modified = true;
+	return entry->partialHash.toHex();
+}
+
+QByteArray HashCache::fullHash(const FileIdentity& identity)
+{
+	QMutexLocker lock(&_mutex);
+	Entry* entry = find(identity);
+
+	if (!entry || entry->fullHash.isEmpty())
+	{
+		++_misses;
+		return {};
+	}
+
+	++_hits;
+	entry->lastSeen = now();
+	_modified = true;
+	return entry->fullHash.toHex();
+}
+
+void HashCache::storePartialHash(const FileIdentity& identity, int sampleCount, const QByteArray& hash)
+{
+	QMutexLocker lock(&_mutex);
+	Entry& entry = insert(identity);
+	entry.sampleCount = sampleCount;
+	entry.partialHash = QByteArray::fromHex(hash);
+}
+
+void HashCache::storeFullHash(const FileIdentity& identity, const QByteArray& hash)
+{
+	QMutexLocker lock(&_mutex);
+	insert(identity).fullHash = QByteArray::fromHex(hash);
+}
+
+void HashCache::resetCounters()
+{
+	_hits = 0;
+	_misses = 0;
+	_evictions = 0;
+}
+
+qint64 HashCache::hits() const
+{
+	return _hits;
+}
+
+qint64 HashCache::misses() const
+{
+	return _misses;
+}
+
+qint64 HashCache::evictions() const
+{
+	return _evictions;
+}
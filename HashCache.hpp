@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QPair>
+#include <QString>
+#include <atomic>
+
+#include "FileIdentity.hpp"
+#include "Hasher.hpp"
+
+// Persistent digests of one algorithm, keyed by the device and inode of a file.
+// A digest is only valid while the size and modification time stay the same.
+class HashCache
+{
+public:
+	explicit HashCache(Hasher::Algorithm algorithm);
+
+	Hasher::Algorithm algorithm() const;
+
+	bool load();
+	bool save();
+
+	// Empty if missing or stale
+	QByteArray partialHash(const FileIdentity& identity, int sampleCount);
+	QByteArray fullHash(const FileIdentity& identity);
+
+	void storePartialHash(const FileIdentity& identity, int sampleCount, const QByteArray& hash);
+	void storeFullHash(const FileIdentity& identity, const QByteArray& hash);
+
+	void resetCounters();
+	qint64 hits() const;
+	qint64 misses() const;
+	qint64 evictions() const;
+
+private:
+	using Key = QPair<quint64, quint64>;
+
+	struct Entry
+	{
+		qint64 size = 0;
+		qint64 modified = 0;
+		qint64 lastSeen = 0;
+		qint32 sampleCount = -1;
+		QByteArray partialHash;
+		QByteArray fullHash;
+	};
+
+	// Returns nullptr and evicts the entry if the file has changed. Expects the mutex to be locked.
+	Entry* find(const FileIdentity& identity);
+	Entry& insert(const FileIdentity& identity);
+
+	QString filePath() const;
+
+	const Hasher::Algorithm _algorithm;
+	QMutex _mutex;
+	QHash<Key, Entry> _entries;
+	bool _modified = false;
+	std::atomic<qint64> _hits { 0 };
+	std::atomic<qint64> _misses { 0 };
+	std::atomic<qint64> _evictions { 0 };
+};
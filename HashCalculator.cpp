@@ -1,10 +1,47 @@
 #include "HashCalculator.hpp"
+#include "DirectoryWalker.hpp"
+#include "StorageDevice.hpp"
 #include <QDebug>
-#include <QDir>
-#include <QDirIterator>
-#include <QMap>
+#include <QElapsedTimer>
+#include <QFileInfo>
+#include <QHash>
+#include <QScopeGuard>
 #include <QStringList>
-#include <array>
+#include <algorithm>
+#include <cstring>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <numeric>
+#include <optional>
+#include <vector>
+
+#ifdef Q_OS_UNIX
+#include <sys/resource.h>
+#endif
+
+namespace
+{
+	// The soft limit of open descriptors of the process
+	int openFileLimit()
+	{
+#ifdef Q_OS_UNIX
+		rlimit limit = {};
+
+		if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur != RLIM_INFINITY)
+		{
+			return int(qMin<rlim_t>(limit.rlim_cur, 0x100000));
+		}
+#endif
+		return 0x2000;
+	}
+
+	qint64 throughput(qint64 bytes, qint64 nanoseconds)
+	{
+		// Megabytes per second
+		return nanoseconds > 0 ? bytes * 1000 / nanoseconds : 0;
+	}
+}
 
 HashCalculator::HashCalculator(QObject* parent) :
 	QThread(parent)
@@ -20,48 +57,119 @@ HashCalculator::~HashCalculator()
 	qDebug() << "Destroyed.";
 }
 
+QString HashCalculator::reason(ErrorType error)
+{
+	switch (error)
+	{
+		case ErrorType::Empty:
+			return "The file appears empty";
+		case ErrorType::Open:
+			return "The file could not be opened";
+		case ErrorType::Read:
+			return "The file could not be read";
+	}
+
+	return "Unknown reason";
+}
+
 void HashCalculator::setDirectory(const QString& directory)
 {
-	_directory = directory;
+	setDirectories({ directory });
+}
+
+void HashCalculator::setDirectories(const QStringList& directories)
+{
+	_directories = directories;
 }
 
 void HashCalculator::setWildcards(const QString& wildcards)
 {
-	if (wildcards.isEmpty())
-	{
-		_wildcards.clear();
-	}
-	else
-	{
-		_wildcards = wildcards.split('|');
-	}
+	_filter.setPatterns(wildcards);
+}
+
+void HashCalculator::setSizeRange(qint64 minimum, qint64 maximum)
+{
+	_filter.setSizeRange(minimum, maximum);
 }
 
-void HashCalculator::setAlgorithm(QCryptographicHash::Algorithm algorithm)
+void HashCalculator::setModifiedRange(qint64 earliest, qint64 latest)
+{
+	_filter.setModifiedRange(earliest, latest);
+}
+
+void HashCalculator::setAlgorithm(Hasher::Algorithm algorithm)
 {
 	_algorithm = algorithm;
 }
 
+void HashCalculator::setConfirmation(bool enabled)
+{
+	_confirmation = enabled;
+}
+
+void HashCalculator::setReadMode(FileReader::Mode readMode)
+{
+	_readMode = readMode;
+}
+
+void HashCalculator::setQueueDepth(int queueDepth)
+{
+	_queueDepth = static_cast<unsigned>(qBound(1, queueDepth, MaxQueueDepth));
+}
+
+int HashCalculator::queueDepth() const
+{
+	return static_cast<int>(_queueDepth);
+}
+
+void HashCalculator::setCacheEnabled(bool enabled)
+{
+	_cacheEnabled = enabled;
+}
+
+void HashCalculator::setComparison(bool enabled)
+{
+	_comparison = enabled;
+}
+
+void HashCalculator::setSampleCount(int sampleCount)
+{
+	_sampleCount = qMax(0, sampleCount);
+}
+
+void HashCalculator::setThreadCount(int threadCount)
+{
+	_threadCount = threadCount > 0 ? threadCount : QThread::idealThreadCount();
+}
+
 bool HashCalculator::keepRunning() const
 {
-	return QThread::currentThread()->isInterruptionRequested() == false;
+	// Called from the worker threads too, hence not QThread::currentThread()
+	return isInterruptionRequested() == false;
 }
 
-QByteArray HashCalculator::calculateHash(const QString& filePath)
+QByteArray HashCalculator::calculateHash(const QString& filePath, HashScope scope, Hasher::Algorithm algorithm)
 {
-	QFile file(filePath);
+	FileReader reader(filePath, _readMode);
 
-	if (!file.open(QFile::ReadOnly))
+	// The samples are read again by the full hash, and the full hash by the confirmation
+	const bool confirmed = _confirmation && !Hasher::isCryptographic(_algorithm) && algorithm == _algorithm;
+	reader.setDropBehind(scope == HashScope::Full && !confirmed);
+
+	if (!reader.open())
 	{
 		emit failure(filePath, ErrorType::Open);
 		return {};
 	}
 
-	QCryptographicHash hash(_algorithm);
-	constexpr int BufferSize = 0x10000; // 64K
-	thread_local std::array<char, BufferSize> buffer = {};
-	qint64 bytesReadTotal = 0;
-	const qint64 bytesLeftTotal = file.size();
+	const auto recordThroughput = qScopeGuard([&]()
+	{
+		_bytesRead += reader.bytesRead();
+		_readTime += reader.readTime();
+	});
+
+	Hasher hash(algorithm);
+	const qint64 bytesLeftTotal = reader.size();
 
 	if (bytesLeftTotal <= 0)
 	{
@@ -69,64 +177,919 @@ QByteArray HashCalculator::calculateHash(const QString& filePath)
 		return {};
 	}
 
-	emit processing(filePath, bytesReadTotal, bytesLeftTotal);
+	if (scope == HashScope::Partial)
+	{
+		const auto addSample = [&](const char* data, qint64 length)
+		{
+			hash.addData(data, length);
+			_progress.add(ScanProgress::BytesRead, length);
+			return true;
+		};
+
+		_progress.add(ScanProgress::PartialHashes);
+
+		for (qint64 offset : sampleOffsets(bytesLeftTotal))
+		{
+			if (!reader.read(offset, SampleSize, addSample))
+			{
+				emit failure(filePath, ErrorType::Read);
+				return {};
+			}
+		}
+
+		return hash.result().toHex();
+	}
+
+	_progress.add(ScanProgress::FullHashes);
+	_progress.setCurrentPath(filePath);
 
-	do
+	const bool success = reader.read(0, bytesLeftTotal, [&](const char* data, qint64 length)
 	{
 		if (!keepRunning())
 		{
-			return {};
+			return false;
 		}
 
-		qint64 bytesRead = file.read(buffer.data(), BufferSize);
+		hash.addData(data, length);
+		_progress.add(ScanProgress::BytesRead, length);
+		return true;
+	});
 
-		if (bytesRead < 0)
+	if (!keepRunning())
+	{
+		return {};
+	}
+
+	if (!success)
+	{
+		emit failure(filePath, ErrorType::Read);
+		return {};
+	}
+
+	return hash.result().toHex();
+}
+
+QList<QByteArray> HashCalculator::calculateHashes(const QStringList& filePaths, Hasher::Algorithm algorithm)
+{
+	QList<QByteArray> results;
+	UringReader* uring = _readMode == FileReader::Mode::Asynchronous ? uringReader() : nullptr;
+
+	if (!uring || !uring->isValid())
+	{
+		for (const QString& filePath : filePaths)
 		{
-			emit failure(filePath, ErrorType::Read);
-			return {};
+			results.append(calculateHash(filePath, HashScope::Full, algorithm));
 		}
 
-		bytesReadTotal += bytesRead;
-		hash.addData(buffer.data(), bytesRead);
-		emit processing(filePath, bytesReadTotal, bytesLeftTotal);
+		return results;
 	}
-	while (bytesReadTotal < bytesLeftTotal);
 
-	return hash.result().toHex();
+	// A deque, because the hashers can not be moved
+	std::deque<Hasher> hashes;
+	std::vector<qint64> bytesReadTotal(filePaths.size(), 0);
+	std::vector<UringReader::Job> jobs;
+	jobs.reserve(filePaths.size());
+
+	for (const QString& filePath : filePaths)
+	{
+		const size_t i = jobs.size();
+		hashes.emplace_back(algorithm);
+
+		jobs.push_back({ filePath, [&, i](const char* data, qint64 length)
+		{
+			if (!keepRunning())
+			{
+				return false;
+			}
+
+			bytesReadTotal[i] += length;
+			hashes[i].addData(data, length);
+			_progress.add(ScanProgress::BytesRead, length);
+			return true;
+		}});
+	}
+
+	_progress.add(ScanProgress::FullHashes, filePaths.size());
+	_progress.setCurrentPath(filePaths.first());
+
+	QElapsedTimer timer;
+	timer.start();
+	uring->read(jobs);
+	_readTime += timer.nsecsElapsed();
+
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		const UringReader::Job& job = jobs[i];
+		_bytesRead += bytesReadTotal[i];
+
+		switch (job.status)
+		{
+			case UringReader::Status::Success:
+				if (job.size > 0)
+				{
+					results.append(hashes[i].result().toHex());
+					continue;
+				}
+
+				emit failure(job.filePath, ErrorType::Empty);
+				break;
+			case UringReader::Status::OpenFailed:
+				emit failure(job.filePath, ErrorType::Open);
+				break;
+			case UringReader::Status::ReadFailed:
+				emit failure(job.filePath, ErrorType::Read);
+				break;
+			case UringReader::Status::Pending:
+			case UringReader::Status::Stopped:
+				break;
+		}
+
+		results.append(QByteArray());
+	}
+
+	return results;
 }
 
-void HashCalculator::run()
+UringReader* HashCalculator::uringReader() const
+{
+	// One ring per worker thread, submissions are not thread safe
+	thread_local std::unique_ptr<UringReader> reader;
+
+	if (!reader || reader->queueDepth() != _queueDepth)
+	{
+		reader = std::make_unique<UringReader>(_queueDepth);
+	}
+
+	return reader.get();
+}
+
+QList<qint64> HashCalculator::sampleOffsets(qint64 fileSize) const
+{
+	// The head and the tail, plus the middle samples spread evenly in between
+	const qint64 lastOffset = fileSize - SampleSize;
+	QList<qint64> offsets = { 0 };
+
+	for (int i = 1; i <= _sampleCount; ++i)
+	{
+		const qint64 offset = lastOffset * i / (_sampleCount + 1);
+		offsets.append(offset - offset % SampleSize);
+	}
+
+	offsets.append(lastOffset);
+	return offsets;
+}
+
+QByteArray HashCalculator::cachedPartialHash(const QString& filePath, const FileIdentity& identity)
+{
+	if (_cache)
+	{
+		const QByteArray cachedHash = _cache->partialHash(identity, _sampleCount);
+
+		if (!cachedHash.isEmpty())
+		{
+			return cachedHash;
+		}
+	}
+
+	// The identity is taken before reading, a change meanwhile invalidates the entry
+	const QByteArray partialHash = calculateHash(filePath, HashScope::Partial, _algorithm);
+
+	if (_cache && !partialHash.isEmpty())
+	{
+		_cache->storePartialHash(identity, _sampleCount, partialHash);
+	}
+
+	return partialHash;
+}
+
+QList<QByteArray> HashCalculator::cachedFullHashes(const QList<Candidate>& candidates, Hasher::Algorithm algorithm, HashCache* cache)
 {
-	QDirIterator* it = _wildcards.empty() ?
-			new QDirIterator(_directory, QDir::Files, QDirIterator::Subdirectories) :
-			new QDirIterator(_directory, _wildcards, QDir::Files, QDirIterator::Subdirectories);
+	QList<QByteArray> results;
+	QStringList uncachedPaths;
+
+	for (const Candidate& candidate : candidates)
+	{
+		const QByteArray cachedHash = cache ? cache->fullHash(candidate.identity) : QByteArray();
+
+		if (cachedHash.isEmpty())
+		{
+			uncachedPaths.append(candidate.path);
+		}
 
-	QMap<QString, QStringList> fileHashes;
+		results.append(cachedHash);
+	}
 
-	while (keepRunning() && it->hasNext())
+	if (uncachedPaths.isEmpty())
 	{
-		const QString path = QDir::toNativeSeparators(it->next());
-		const QByteArray fileHash = calculateHash(path);
+		return results;
+	}
 
-		if (fileHash.isEmpty())
+	const QList<QByteArray> calculatedHashes = calculateHashes(uncachedPaths, algorithm);
+
+	for (qsizetype i = 0, j = 0; i < results.size(); ++i)
+	{
+		if (!results[i].isEmpty())
 		{
 			continue;
 		}
 
-		fileHashes[fileHash].emplaceBack(path);
-		int size = fileHashes[fileHash].size();
+		results[i] = calculatedHashes[j++];
 
-		if (size == 2)
+		if (cache && !results[i].isEmpty())
 		{
-			emit duplicateFound(fileHash, fileHashes[fileHash].first());
-			emit duplicateFound(fileHash, path);
+			cache->storeFullHash(candidates[i].identity, results[i]);
 		}
+	}
 
-		if (size > 2)
+	return results;
+}
+
+qint64 HashCalculator::partialThreshold() const
+{
+	// If the samples would cover the whole file anyway, skip straight to the full hash
+	return SampleSize * (_sampleCount + 2);
+}
+
+void HashCalculator::processCandidate(const Candidate& candidate, QList<Candidate>& escalated)
+{
+	if (!keepRunning())
+	{
+		return;
+	}
+
+	const QString& path = candidate.path;
+	const FileIdentity& identity = candidate.identity;
+	const qint64 size = identity.size;
+
+	// Only the first path of an inode is hashed. Besides hard links, a symbolic link to a file and
+	// its target, or the same file seen through a bind mount, share the inode with a link count of one.
+	// Such paths are reported as already sharing the storage, never as a reclaimable duplicate.
+	const QStringList hardlinks = _inodes.insert({ identity.device, identity.inode }, path);
+
+	if (!hardlinks.isEmpty())
+	{
+		const QString inode = QString("%1:%2").arg(identity.device).arg(identity.inode);
+
+		for (const QString& hardlink : hardlinks)
 		{
-			emit duplicateFound(fileHash, path);
+			report({ inode, hardlink, size, true });
+			_progress.add(ScanProgress::Hardlinks);
 		}
+
+		return;
+	}
+
+	QList<Candidate> matches = { candidate };
+	QByteArray groupKey = QByteArray::number(size) + ':';
+
+	if (size > partialThreshold())
+	{
+		// Most same size files differ already in their first or last few kilobytes
+		const QByteArray partialHash = cachedPartialHash(path, identity);
+
+		if (partialHash.isEmpty())
+		{
+			return;
+		}
+
+		groupKey += partialHash;
+		matches = _partialHashes.insert(groupKey, candidate);
+	}
+	else if (_comparison)
+	{
+		_partialHashes.insert(groupKey, candidate);
+	}
+
+	// The comparison needs whole groups, it starts once the traversal is over.
+	// A group is read through the queue of the device of any of its files
+	if (_comparison)
+	{
+		QMutexLocker lock(&_groupQueuesMutex);
+		_groupQueues.insert(groupKey, candidate.queue);
+		return;
 	}
 
-	delete it;
+	escalated.append(matches);
+}
+
+void HashCalculator::hashCandidates(const QList<Candidate>& candidates)
+{
+	if (candidates.isEmpty() || !keepRunning())
+	{
+		return;
+	}
+
+	const QList<QByteArray> fileHashes = cachedFullHashes(candidates, _algorithm, _cache.get());
+
+	for (qsizetype i = 0; i < candidates.size(); ++i)
+	{
+		if (fileHashes[i].isEmpty())
+		{
+			continue;
+		}
+
+		const QList<Candidate> duplicates = _fileHashes.insert(fileHashes[i], candidates[i]);
+
+		if (_confirmation && !Hasher::isCryptographic(_algorithm))
+		{
+			confirmDuplicates(duplicates);
+			continue;
+		}
+
+		for (const Candidate& duplicate : duplicates)
+		{
+			report({ fileHashes[i], duplicate.path, duplicate.identity.size });
+			_progress.add(ScanProgress::Duplicates);
+		}
+	}
+}
+
+void HashCalculator::compareCandidates(const QList<Candidate>& candidates)
+{
+	if (candidates.isEmpty() || !keepRunning())
+	{
+		return;
+	}
+
+	if (candidates.size() > MaxComparedFiles || candidates.size() > _comparedFileLimit)
+	{
+		hashCandidates(candidates);
+		return;
+	}
+
+	const qint64 size = candidates.first().identity.size;
+
+	struct Member
+	{
+		QString path;
+		std::unique_ptr<FileReader> reader;
+		QByteArray block;
+	};
+
+	std::vector<Member> members;
+
+	// Taken all at once, so that concurrent comparisons can not each hold a part
+	_comparedFiles.acquire(int(candidates.size()));
+
+	const auto release = [this](Member& member)
+	{
+		_bytesRead += member.reader->bytesRead();
+		_readTime += member.reader->readTime();
+		member.reader.reset();
+		_comparedFiles.release();
+	};
+
+	for (const Candidate& candidate : candidates)
+	{
+		const QString& path = candidate.path;
+		auto reader = std::make_unique<FileReader>(path, _readMode);
+
+		// Each block is compared once
+		reader->setDropBehind(true);
+
+		if (!reader->open())
+		{
+			emit failure(path, ErrorType::Open);
+			_comparedFiles.release();
+			continue;
+		}
+
+		// Changed since the traversal
+		if (reader->size() != size)
+		{
+			_comparedFiles.release();
+			continue;
+		}
+
+		members.push_back({ path, std::move(reader), {} });
+	}
+
+	// Sets of members identical so far. A set is split as soon as its members differ
+	// and a member left alone is closed right away, so most reads stop after a few blocks
+	std::vector<std::vector<size_t>> sets;
+
+	if (members.size() > 1)
+	{
+		sets.emplace_back(members.size());
+		std::iota(sets.front().begin(), sets.front().end(), 0);
+	}
+
+	for (qint64 offset = 0; offset < size && !sets.empty() && keepRunning(); offset += FileReader::BlockSize)
+	{
+		const qint64 length = qMin(FileReader::BlockSize, size - offset);
+		std::vector<std::vector<size_t>> remaining;
+
+		for (const std::vector<size_t>& set : sets)
+		{
+			std::vector<std::vector<size_t>> splits;
+
+			for (size_t index : set)
+			{
+				Member& member = members[index];
+				member.block.resize(0);
+
+				// The block is compared in place with the first member of each split.
+				// Only a member which matches none is copied, to become the first of a new split
+				std::vector<size_t> matching(splits.size());
+				std::iota(matching.begin(), matching.end(), 0);
+				qint64 position = 0;
+				bool first = false;
+
+				const bool success = member.reader->read(offset, length, [&](const char* data, qint64 chunkLength)
+				{
+					_progress.add(ScanProgress::BytesRead, chunkLength);
+
+					if (!first)
+					{
+						const auto differs = [&](size_t split)
+						{
+							const char* block = members[splits[split].front()].block.constData();
+							return std::memcmp(block + position, data, size_t(chunkLength)) != 0;
+						};
+
+						const size_t matched = matching.empty() ? 0 : matching.front();
+						matching.erase(std::remove_if(matching.begin(), matching.end(), differs), matching.end());
+
+						if (matching.empty())
+						{
+							// So far the member matched the dropped split, the beginning is the same
+							first = true;
+
+							if (position > 0)
+							{
+								member.block = members[splits[matched].front()].block.left(position);
+							}
+						}
+					}
+
+					if (first)
+					{
+						member.block.append(data, chunkLength);
+					}
+
+					position += chunkLength;
+					return true;
+				});
+
+				if (!success)
+				{
+					emit failure(member.path, ErrorType::Read);
+					release(member);
+					continue;
+				}
+
+				if (first)
+				{
+					splits.push_back({ index });
+				}
+				else
+				{
+					splits[matching.front()].push_back(index);
+				}
+			}
+
+			for (std::vector<size_t>& split : splits)
+			{
+				if (split.size() > 1)
+				{
+					remaining.push_back(std::move(split));
+				}
+				else
+				{
+					release(members[split.front()]);
+				}
+			}
+		}
+
+		sets.swap(remaining);
+	}
+
+	if (keepRunning())
+	{
+		for (const std::vector<size_t>& set : sets)
+		{
+			// Nothing was hashed, the label only has to tell the groups apart
+			const QString label = QString("%1 bytes #%2").arg(size).arg(++_comparedGroups);
+
+			for (size_t index : set)
+			{
+				report({ label, members[index].path, size });
+				_progress.add(ScanProgress::Duplicates);
+			}
+		}
+	}
+
+	for (Member& member : members)
+	{
+		if (member.reader)
+		{
+			release(member);
+		}
+	}
+}
+
+void HashCalculator::confirmDuplicates(const QList<Candidate>& candidates)
+{
+	if (candidates.isEmpty() || !keepRunning())
+	{
+		return;
+	}
+
+	// Rules out collisions of the non-cryptographic hash before anything gets deleted
+	const QList<QByteArray> fileHashes = cachedFullHashes(candidates, Hasher::Algorithm::Sha256, _confirmationCache.get());
+
+	for (qsizetype i = 0; i < candidates.size(); ++i)
+	{
+		if (fileHashes[i].isEmpty())
+		{
+			continue;
+		}
+
+		for (const QString& duplicate : _confirmedHashes.insert(fileHashes[i], candidates[i].path))
+		{
+			report({ fileHashes[i], duplicate, candidates[i].identity.size });
+			_progress.add(ScanProgress::Duplicates);
+		}
+	}
+}
+
+void HashCalculator::consumeCandidates(BoundedQueue<Candidate>* queue)
+{
+	Candidate candidate;
+	QList<Candidate> escalated;
+	QElapsedTimer timer;
+
+	// io_uring reads a batch of files at once, so the files escalated to a full hash are
+	// gathered until they fill the ring or the queue runs dry. The other modes read one by one
+	const qsizetype batchSize = _readMode == FileReader::Mode::Asynchronous ? qsizetype(_queueDepth) : 1;
+
+	// After an interruption the remaining candidates return immediately,
+	// which drains the queue and unblocks the traversal
+	while (queue->pop(candidate))
+	{
+		timer.start();
+		processCandidate(candidate, escalated);
+
+		if (escalated.size() >= batchSize || queue->isEmpty())
+		{
+			hashCandidates(escalated);
+			escalated.clear();
+		}
+
+		_hashingTime += timer.nsecsElapsed();
+		_progress.add(ScanProgress::ResolvedFiles);
+		_progress.add(ScanProgress::ResolvedBytes, candidate.identity.size);
+	}
+
+	hashCandidates(escalated);
+}
+
+void HashCalculator::consumeGroups(BoundedQueue<ComparedGroup>* queue)
+{
+	ComparedGroup group;
+	QElapsedTimer timer;
+
+	while (queue->pop(group))
+	{
+		timer.start();
+		compareCandidates(group);
+		_hashingTime += timer.nsecsElapsed();
+	}
+}
+
+void HashCalculator::traverse(const QString& root, int queue, int threadCount)
+{
+	const auto visit = [&](const QString& path, const FileIdentity& identity)
+	{
+		const qint64 size = identity.size;
+
+		if (size <= 0)
+		{
+			emit failure(path, ErrorType::Empty);
+			return;
+		}
+
+		// The current path is left to the hashing, it would serialize the walkers
+		_progress.add(ScanProgress::FilesFound);
+
+		QList<Candidate> candidates;
+
+		{
+			// Fibonacci hashing, as the sizes of many files are multiples of a block size and share the low bits
+			SizeShard& shard = _fileSizes[(quint64(size) * 0x9E3779B97F4A7C15ull) >> 58];
+			QMutexLocker lock(&shard.mutex);
+			auto sizeGroup = shard.candidates.find(size);
+
+			if (sizeGroup == shard.candidates.end())
+			{
+				shard.candidates.insert(size, { path, identity, queue });
+				return;
+			}
+
+			if (!sizeGroup->path.isEmpty())
+			{
+				candidates.append(*sizeGroup);
+				sizeGroup->path.clear();
+			}
+		}
+
+		candidates.append({ path, identity, queue });
+
+		// Pushed outside of the lock, a full queue of one device must not stall the others
+		for (const Candidate& candidate : candidates)
+		{
+			_queues[candidate.queue]->push(candidate);
+			_progress.add(ScanProgress::Candidates);
+			_progress.add(ScanProgress::CandidateBytes, size);
+		}
+	};
+
+	DirectoryWalker walker(root, _filter, threadCount);
+	walker.walk(visit, std::bind(&HashCalculator::keepRunning, this));
+}
+
+QStringList HashCalculator::collapseRoots(const QStringList& directories)
+{
+	QStringList roots;
+
+	for (const QString& directory : directories)
+	{
+		const QString canonical = QFileInfo(directory).canonicalFilePath();
+
+		if (canonical.isEmpty())
+		{
+			qWarning() << directory << "does not exist";
+			continue;
+		}
+
+		roots.append(canonical);
+	}
+
+	// Sorted, an ancestor comes before the roots nested in it
+	roots.sort();
+	roots.removeDuplicates();
+
+	QStringList results;
+
+	for (const QString& root : roots)
+	{
+		const auto contains = [&](const QString& ancestor)
+		{
+			return root.startsWith(ancestor.endsWith('/') ? ancestor : ancestor + '/');
+		};
+
+		const auto ancestor = std::find_if(results.cbegin(), results.cend(), contains);
+
+		if (ancestor != results.cend())
+		{
+			qDebug() << root << "is scanned as part of" << *ancestor;
+			continue;
+		}
+
+		results.append(root);
+	}
+
+	return results;
+}
+
+void HashCalculator::openCaches()
+{
+	if (!_cacheEnabled)
+	{
+		_cache.reset();
+		_confirmationCache.reset();
+		return;
+	}
+
+	if (!_cache || _cache->algorithm() != _algorithm)
+	{
+		_cache = std::make_unique<HashCache>(_algorithm);
+		_cache->load();
+	}
+
+	const bool confirming = _confirmation && !Hasher::isCryptographic(_algorithm);
+
+	if (confirming && !_confirmationCache)
+	{
+		_confirmationCache = std::make_unique<HashCache>(Hasher::Algorithm::Sha256);
+		_confirmationCache->load();
+	}
+
+	_cache->resetCounters();
+
+	if (_confirmationCache)
+	{
+		_confirmationCache->resetCounters();
+	}
+}
+
+void HashCalculator::saveCaches()
+{
+	for (HashCache* cache : { _cache.get(), _confirmationCache.get() })
+	{
+		if (!cache)
+		{
+			continue;
+		}
+
+		qDebug() << "Cache" << Hasher::name(cache->algorithm()) << ':' << cache->hits() << "hits,"
+			<< cache->misses() << "misses," << cache->evictions() << "evicted";
+
+		cache->save();
+	}
+}
+
+void HashCalculator::report(const Duplicate& duplicate)
+{
+	DuplicateList batch;
+
+	{
+		QMutexLocker lock(&_batchMutex);
+		_batch.append(duplicate);
+
+		// A lingering batch is sent by waitForDone()
+		if (_batch.size() < BatchSize && _batchTimer.isValid() && _batchTimer.elapsed() < BatchInterval)
+		{
+			return;
+		}
+
+		batch.swap(_batch);
+		_batchTimer.start();
+	}
+
+	emit duplicatesFound(batch);
+}
+
+void HashCalculator::flushDuplicates()
+{
+	DuplicateList batch;
+
+	{
+		QMutexLocker lock(&_batchMutex);
+		batch.swap(_batch);
+		_batchTimer.start();
+	}
+
+	if (!batch.isEmpty())
+	{
+		emit duplicatesFound(batch);
+	}
+}
+
+void HashCalculator::waitForDone(QThreadPool& pool)
+{
+	// The batch is otherwise only sent when the next duplicate is found
+	while (!pool.waitForDone(int(BatchInterval)))
+	{
+		flushDuplicates();
+	}
+}
+
+ScanProgress::Snapshot HashCalculator::progress() const
+{
+	return _progress.snapshot();
+}
+
+void HashCalculator::run()
+{
+	_progress.reset();
+	openCaches();
+	_partialHashes.clear();
+	_groupQueues.clear();
+	_fileHashes.clear();
+	_confirmedHashes.clear();
+	_inodes.clear();
+
+	for (SizeShard& shard : _fileSizes)
+	{
+		shard.candidates.clear();
+	}
+
+	_queues.clear();
+	flushDuplicates();
+	_hashingTime = 0;
+	_bytesRead = 0;
+	_readTime = 0;
+
+	// Each device gets its own queue and consumers, so that the devices are read in parallel
+	// and a spinning disk is read by one thread while a solid state one is read by many
+	const QStringList roots = collapseRoots(_directories);
+	QHash<quint64, int> deviceQueues;
+	QList<int> rootQueues;
+	QList<int> consumerCounts;
+
+	for (const QString& root : roots)
+	{
+		const std::optional<FileIdentity> identity = FileIdentity::of(root);
+		const quint64 device = identity ? identity->device : 0;
+		auto deviceQueue = deviceQueues.find(device);
+
+		if (deviceQueue == deviceQueues.end())
+		{
+			const bool rotational = StorageDevice::isRotational(device);
+			deviceQueue = deviceQueues.insert(device, int(_queues.size()));
+			_queues.push_back(std::make_unique<BoundedQueue<Candidate>>(QueueCapacity));
+			consumerCounts.append(rotational ? 1 : _threadCount);
+
+			qDebug() << "Device" << device << (rotational ? "is rotational," : "is not rotational,")
+				<< consumerCounts.last() << "threads";
+		}
+
+		rootQueues.append(deviceQueue.value());
+	}
+
+	_pool.setMaxThreadCount(qMax(1, std::accumulate(consumerCounts.cbegin(), consumerCounts.cend(), 0)));
+	_traversalPool.setMaxThreadCount(qMax(1, int(roots.size())));
+
+	for (qsizetype i = 0; i < consumerCounts.size(); ++i)
+	{
+		for (int j = 0; j < consumerCounts[i]; ++j)
+		{
+			_pool.start(std::bind(&HashCalculator::consumeCandidates, this, _queues[i].get()));
+		}
+	}
+
+	QElapsedTimer traversalTimer;
+	traversalTimer.start();
+
+	for (qsizetype i = 0; i < roots.size(); ++i)
+	{
+		// A spinning disk is walked by a single thread too
+		_traversalPool.start(std::bind(&HashCalculator::traverse, this, roots[i], rootQueues[i], consumerCounts[rootQueues[i]]));
+	}
+
+	waitForDone(_traversalPool);
+
+	const qint64 traversalTime = traversalTimer.elapsed();
+	qint64 producerWaitTime = 0;
+	qint64 consumerWaitTime = 0;
+
+	for (const auto& queue : _queues)
+	{
+		queue->close();
+	}
+
+	waitForDone(_pool);
+
+	for (const auto& queue : _queues)
+	{
+		producerWaitTime += queue->producerWaitTime();
+		consumerWaitTime += queue->consumerWaitTime();
+	}
+
+	if (_comparison)
+	{
+		_comparedGroups = 0;
+
+		// The hashing is over, nearly all descriptors are free for the comparisons
+		_comparedFileLimit = qMax(2, openFileLimit() - ReservedFiles);
+		_comparedFiles.acquire(_comparedFiles.available());
+		_comparedFiles.release(_comparedFileLimit);
+
+		// The groups are read with the same consumers per device as the candidates
+		std::vector<std::unique_ptr<BoundedQueue<ComparedGroup>>> groupQueues;
+
+		for (qsizetype i = 0; i < consumerCounts.size(); ++i)
+		{
+			groupQueues.push_back(std::make_unique<BoundedQueue<ComparedGroup>>(QueueCapacity));
+
+			for (int j = 0; j < consumerCounts[i]; ++j)
+			{
+				_pool.start(std::bind(&HashCalculator::consumeGroups, this, groupQueues.back().get()));
+			}
+		}
+
+		const QHash<QByteArray, ComparedGroup> groups = _partialHashes.groups();
+
+		for (auto it = groups.cbegin(); it != groups.cend(); ++it)
+		{
+			groupQueues[size_t(_groupQueues.value(it.key()))]->push(it.value());
+		}
+
+		for (const auto& queue : groupQueues)
+		{
+			queue->close();
+		}
+
+		waitForDone(_pool);
+	}
+
+	flushDuplicates();
+
+	// Whatever was hashed before an interruption is still valid
+	saveCaches();
+
+	const ScanProgress::Snapshot progress = _progress.snapshot();
+
+	qDebug() << "Traversal:" << progress.value(ScanProgress::FilesFound) << "files,"
+		<< progress.value(ScanProgress::Candidates) << "candidates in" << roots.size() << "roots in"
+		<< traversalTime << "ms, blocked by a full queue for"
+		<< producerWaitTime / 1000000 << "ms";
+
+	qDebug() << "Hashing:" << _hashingTime / 1000000 << "ms busy,"
+		<< consumerWaitTime / 1000000 << "ms idle in total of"
+		<< _pool.maxThreadCount() << "threads";
+
+	qDebug() << "Reading:" << _bytesRead / 1000000 << "MB in" << _readTime / 1000000 << "ms" << "using"
+		<< FileReader::name(_readMode) << "reads," << throughput(_bytesRead, _readTime) << "MB/s per thread";
 }
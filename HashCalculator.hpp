@@ -1,8 +1,26 @@
 #pragma once
 
+#include <QElapsedTimer>
+#include <QMutex>
 #include <QObject>
+#include <QSemaphore>
 #include <QThread>
-#include <QCryptographicHash>
+#include <QThreadPool>
+
+#include "BoundedQueue.hpp"
+#include "Duplicate.hpp"
+#include "FileReader.hpp"
+#include "HashCache.hpp"
+#include "PathFilter.hpp"
+#include "Hasher.hpp"
+#include "PathGroups.hpp"
+#include "ScanProgress.hpp"
+#include "UringReader.hpp"
+
+#include <array>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 class HashCalculator : public QThread
 {
@@ -16,26 +34,140 @@ public:
 		Read = 'r'
 	};
 
+	static QString reason(ErrorType error);
+
+	// Each read in flight has a block sized buffer of its own
+	static constexpr int MaxQueueDepth = 0x400;
+
 	HashCalculator(QObject* parent);
 	~HashCalculator();
 
 	void setDirectory(const QString& directory);
-	void setAlgorithm(QCryptographicHash::Algorithm algorithm);
+	// Nested roots are scanned once, as part of the outermost root
+	void setDirectories(const QStringList& directories);
+	void setAlgorithm(Hasher::Algorithm algorithm);
+	void setConfirmation(bool enabled);
+	void setReadMode(FileReader::Mode readMode);
+	// Reads in flight per hashing thread when reading through io_uring
+	void setQueueDepth(int queueDepth);
+	int queueDepth() const;
+	void setCacheEnabled(bool enabled);
+	// Compares the candidates byte by byte instead of hashing them
+	void setComparison(bool enabled);
+
+	// Thread safe, meant to be polled at the display rate
+	ScanProgress::Snapshot progress() const;
+	// See PathFilter for the pattern syntax
 	void setWildcards(const QString& wildcards);
+	// Zero maximum for no limit
+	void setSizeRange(qint64 minimum, qint64 maximum);
+	// Seconds since the epoch
+	void setModifiedRange(qint64 earliest, qint64 latest);
+	void setSampleCount(int sampleCount);
+	void setThreadCount(int threadCount);
 
 signals:
-	void processing(const QString& filePath, qint64 bytesRead, qint64 bytesLeft);
-	void duplicateFound(const QString& hashString, const QString& filePath);
+	void duplicatesFound(const DuplicateList& duplicates);
 	void failure(const QString& filePath, ErrorType error);
 
 private:
+	enum class HashScope
+	{
+		Partial,
+		Full
+	};
+
+	// The identity is the one the traversal stat'ed, a candidate is not stat'ed again
+	struct Candidate
+	{
+		QString path;
+		FileIdentity identity;
+		int queue = 0; // The queue of the device the file is on
+	};
+
+	// Same size files, which the comparison reads side by side
+	using ComparedGroup = QList<Candidate>;
+
+	// The first file of each size seen, see _fileSizes
+	struct SizeShard
+	{
+		QMutex mutex;
+		QHash<qint64, Candidate> candidates;
+	};
+
+	static constexpr qint64 SampleSize = 0x1000; // 4K
+	static constexpr qsizetype QueueCapacity = 0x400;
+	static constexpr qsizetype BatchSize = 0x400;
+	static constexpr qint64 BatchInterval = 100; // Milliseconds
+	// Compared files are all kept open, larger groups are hashed instead
+	static constexpr qsizetype MaxComparedFiles = 0x40;
+	// Descriptors left to the rest of the process when the comparisons open files
+	static constexpr int ReservedFiles = 0x100;
+	static constexpr size_t SizeShardCount = 0x40; // The top six bits of the hashed size
+
 	bool keepRunning() const;
-	QByteArray calculateHash(const QString& filePath);
+	QByteArray calculateHash(const QString& filePath, HashScope scope, Hasher::Algorithm algorithm);
+	QList<QByteArray> calculateHashes(const QStringList& filePaths, Hasher::Algorithm algorithm);
+	UringReader* uringReader() const;
+	QByteArray cachedPartialHash(const QString& filePath, const FileIdentity& identity);
+	QList<QByteArray> cachedFullHashes(const QList<Candidate>& candidates, Hasher::Algorithm algorithm, HashCache* cache);
+	void openCaches();
+	void saveCaches();
+	QList<qint64> sampleOffsets(qint64 fileSize) const;
+	qint64 partialThreshold() const;
+	// Appends the candidates which need a full hash to the escalated ones
+	void processCandidate(const Candidate& candidate, QList<Candidate>& escalated);
+	void hashCandidates(const QList<Candidate>& candidates);
+	void compareCandidates(const QList<Candidate>& candidates);
+	void confirmDuplicates(const QList<Candidate>& candidates);
+	void report(const Duplicate& duplicate);
+	void flushDuplicates();
+	void waitForDone(QThreadPool& pool);
+	void consumeCandidates(BoundedQueue<Candidate>* queue);
+	void consumeGroups(BoundedQueue<ComparedGroup>* queue);
+	void traverse(const QString& root, int queue, int threadCount);
+	static QStringList collapseRoots(const QStringList& directories);
 	void run() override;
 
-	QString _directory;
-	QStringList _wildcards;
-	QCryptographicHash::Algorithm _algorithm = QCryptographicHash::Sha256;
+	QStringList _directories;
+	PathFilter _filter;
+	Hasher::Algorithm _algorithm = Hasher::Algorithm::Sha256;
+	bool _confirmation = true;
+	FileReader::Mode _readMode = FileReader::Mode::Buffered;
+	unsigned _queueDepth = 32;
+	bool _cacheEnabled = true;
+	bool _comparison = false;
+	std::atomic<qint64> _comparedGroups { 0 };
+	// The files the comparisons may keep open at once, within the descriptor limit
+	QSemaphore _comparedFiles;
+	int _comparedFileLimit = 0;
+	std::unique_ptr<HashCache> _cache;
+	std::unique_ptr<HashCache> _confirmationCache;
+	int _sampleCount = 2;
+	int _threadCount = QThread::idealThreadCount();
+	QThreadPool _pool;
+	QThreadPool _traversalPool;
+	// One per device, each with as many consumers as the device handles well
+	std::vector<std::unique_ptr<BoundedQueue<Candidate>>> _queues;
+	// A file with a unique size cannot have a duplicate, so a file is only
+	// passed on once another file of the same size shows up. An emptied
+	// path marks a size whose first file has already been passed on.
+	// Sharded by size, so that the walking threads rarely wait for each other.
+	std::array<SizeShard, SizeShardCount> _fileSizes;
+	ScanProgress _progress;
+	QMutex _batchMutex;
+	DuplicateList _batch;
+	QElapsedTimer _batchTimer;
+	std::atomic<qint64> _hashingTime { 0 };
+	std::atomic<qint64> _bytesRead { 0 };
+	std::atomic<qint64> _readTime { 0 };
+	PathGroups<QByteArray, Candidate> _partialHashes;
+	// The queue of the device a compared group is read from, by the key of the group
+	QMutex _groupQueuesMutex;
+	QHash<QByteArray, int> _groupQueues;
+	PathGroups<QByteArray, Candidate> _fileHashes;
+	PathGroups<QByteArray> _confirmedHashes;
+	PathGroups<QPair<quint64, quint64>> _inodes;
 };
 
 Q_DECLARE_METATYPE(HashCalculator::ErrorType)
@@ -0,0 +1,71 @@
+#include "Hasher.hpp"
+
+namespace
+{
+	QCryptographicHash::Algorithm cryptographicAlgorithm(Hasher::Algorithm algorithm)
+	{
+		switch (algorithm)
+		{
+			case Hasher::Algorithm::Md5:
+				return QCryptographicHash::Md5;
+			case Hasher::Algorithm::Sha1:
+				return QCryptographicHash::Sha1;
+			case Hasher::Algorithm::Sha256:
+			case Hasher::Algorithm::Fast128:
+				break;
+			case Hasher::Algorithm::Sha512:
+				return QCryptographicHash::Sha512;
+		}
+
+		return QCryptographicHash::Sha256;
+	}
+}
+
+Hasher::Hasher(Algorithm algorithm)
+{
+	if (isCryptographic(algorithm))
+	{
+		_cryptographicHash.emplace(cryptographicAlgorithm(algorithm));
+	}
+}
+
+void Hasher::addData(const char* data, qint64 length)
+{
+	if (_cryptographicHash)
+	{
+		_cryptographicHash->addData(data, length);
+	}
+	else
+	{
+		_fastHash.addData(data, length);
+	}
+}
+
+QByteArray Hasher::result() const
+{
+	return _cryptographicHash ? _cryptographicHash->result() : _fastHash.result();
+}
+
+bool Hasher::isCryptographic(Algorithm algorithm)
+{
+	return algorithm != Algorithm::Fast128;
+}
+
+QString Hasher::name(Algorithm algorithm)
+{
+	switch (algorithm)
+	{
+		case Algorithm::Md5:
+			return "MD5";
+		case Algorithm::Sha1:
+			return "SHA-1";
+		case Algorithm::Sha256:
+			return "SHA-256";
+		case Algorithm::Sha512:
+			return "SHA-512";
+		case Algorithm::Fast128:
+			return "Fast128";
+	}
+
+	return "Unknown";
+}
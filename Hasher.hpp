@@ -0,0 +1,33 @@
+#pragma once
+
+#include <QCryptographicHash>
+#include <QString>
+#include <optional>
+
+#include "FastHash.hpp"
+
+// Common interface for the cryptographic hashes provided by Qt and the fast non-cryptographic one
+class Hasher
+{
+public:
+	enum class Algorithm : char
+	{
+		Md5,
+		Sha1,
+		Sha256,
+		Sha512,
+		Fast128
+	};
+
+	explicit Hasher(Algorithm algorithm);
+
+	void addData(const char* data, qint64 length);
+	QByteArray result() const;
+
+	static bool isCryptographic(Algorithm algorithm);
+	static QString name(Algorithm algorithm);
+
+private:
+	std::optional<QCryptographicHash> _cryptographicHash;
+	FastHash _fastHash;
+};
@@ -1,6 +1,8 @@
+#include "ConsoleScanner.hpp"
 #include "MainWindow.hpp"
 
 #include <QApplication>
+#include <QCoreApplication>
 #include <QDebug>
 #include <QTime>
 #include <QScreen>
@@ -26,8 +28,16 @@ char qtMsgTypeToChar(QtMsgType type)
 	return '?';
 }
 
+// In headless mode the standard output carries the results
+bool standardOutputReserved = false;
+
 std::ostream& qtMsgTypeToStreamType(QtMsgType type)
 {
+	if (standardOutputReserved)
+	{
+		return std::cerr;
+	}
+
 	switch (type)
 	{
 		case QtDebugMsg:
@@ -95,10 +105,32 @@ void resizeToScreen(MainWindow& window)
 	}
 }
 
+int runHeadless(int argc, char* argv[])
+{
+	standardOutputReserved = true;
+
+	QCoreApplication application(argc, argv);
+	ConsoleScanner scanner;
+
+	if (!scanner.parseArguments(application.arguments()))
+	{
+		return ConsoleScanner::Error;
+	}
+
+	scanner.start();
+
+	return application.exec();
+}
+
 int main(int argc, char* argv[])
 {
 	qInstallMessageHandler(duffMessageHandler);
 
+	if (ConsoleScanner::isRequested(argc, argv))
+	{
+		return runHeadless(argc, argv);
+	}
+
 	QApplication application(argc, argv);
 	MainWindow window;
 
@@ -8,25 +8,27 @@
 #include <QDesktopServices>
 #include <QDir>
 #include <QFileDialog>
+#include <QHeaderView>
+#include <QInputDialog>
 #include <QMessageBox>
 #include <QTime>
 #include <QTimer>
 #include <QTreeWidgetItem>
 
-QString reason(HashCalculator::ErrorType error)
+#include <algorithm>
+
+namespace
 {
-	switch (error)
-	{
-		case HashCalculator::ErrorType::Empty:
-			return "The file appears empty";
-		case HashCalculator::ErrorType::Open:
-			return "The file could not be opened";
-		case HashCalculator::ErrorType::Read:
-			return "The file could not be read";
-	}
+	QString formatDuration(qint64 milliseconds)
+	{
+		const qint64 seconds = milliseconds / 1000;
 
-	return "Uknown reason";
-};
+		return QString("%1:%2:%3")
+			.arg(seconds / 3600)
+			.arg(seconds / 60 % 60, 2, 10, QChar('0'))
+			.arg(seconds % 60, 2, 10, QChar('0'));
+	}
+}
 
 QPalette windowTextPalette(const QColor& color)
 {
@@ -39,19 +41,31 @@ MainWindow::MainWindow(QWidget* parent) :
 	QMainWindow(parent),
 	ui(new Ui::MainWindow()),
 	_hashCalculator(new HashCalculator(this)),
-	_model(new ResultModel(this))
+	_pathChecker(new PathChecker(this)),
+	_fileRemover(new FileRemover(this)),
+	_deduplicator(new Deduplicator(this)),
+	_model(new ResultModel(this)),
+	_progressTimer(new QTimer(this))
 {
 	ui->setupUi(this);
 
 	ui->treeViewResults->setModel(_model);
+	// The groups wasting the most space first, the model sorts itself
+	ui->treeViewResults->header()->setSortIndicator(ResultModel::ReclaimableColumn, Qt::DescendingOrder);
+	ui->treeViewResults->setSortingEnabled(true);
 	connect(ui->treeViewResults, &QTreeWidget::customContextMenuRequested, this, &MainWindow::createFileContextMenu);
 
 	connect(ui->lineEditSelectedDirectory, &QLineEdit::textChanged, [this](const QString& text)
 	{
-		const QFileInfo info(text);
+		const QStringList directories = text.split('|', Qt::SkipEmptyParts);
 		QPalette palette;
 
-		if (info.isDir())
+		const auto isDirectory = [](const QString& directory)
+		{
+			return QFileInfo(directory).isDir();
+		};
+
+		if (!directories.isEmpty() && std::all_of(directories.cbegin(), directories.cend(), isDirectory))
 		{
 			emit inputReady();
 		}
@@ -67,10 +81,78 @@ MainWindow::MainWindow(QWidget* parent) :
 	connect(ui->pushButtonDeleteSelected, &QPushButton::clicked, this, &MainWindow::deleteSelected);
 	connect(ui->pushButtonRefresh, &QPushButton::clicked, this, &MainWindow::onRefresh);
 
+	connect(_pathChecker, &PathChecker::missingPathsFound, this, &MainWindow::onMissingPathsFound);
+	connect(_pathChecker, &PathChecker::started, this, [this]()
+	{
+		ui->pushButtonRefresh->setText("Cancel refresh");
+	});
+	connect(_pathChecker, &PathChecker::finished, this, [this]()
+	{
+		ui->pushButtonRefresh->setText("Refresh");
+	});
+
+	connect(_fileRemover, &FileRemover::filesRemoved, this, &MainWindow::onFilesRemoved);
+	connect(_fileRemover, &FileRemover::removalFailed, this, &MainWindow::onRemovalFailed);
+	connect(_fileRemover, &FileRemover::started, this, [this]()
+	{
+		ui->pushButtonDeleteSelected->setText("Cancel delete");
+	});
+	connect(_fileRemover, &FileRemover::finished, this, [this]()
+	{
+		ui->pushButtonDeleteSelected->setText("Delete Selected");
+	});
+
+	connect(ui->pushButtonDeduplicateSelected, &QPushButton::clicked, this, &MainWindow::deduplicateSelected);
+	connect(_deduplicator, &Deduplicator::deduplicated, this, &MainWindow::onDeduplicated);
+	connect(_deduplicator, &Deduplicator::progressed, this, [this](qsizetype processed, qsizetype total)
+	{
+		const QString message =
+			QString("%1 Deduplicated %2 / %3 group(s)")
+				.arg(QTime::currentTime().toString())
+				.arg(processed)
+				.arg(total);
+
+		ui->statusBar->setPalette(windowTextPalette(Qt::darkCyan));
+		ui->statusBar->showMessage(message);
+	});
+	connect(_deduplicator, &Deduplicator::started, this, [this]()
+	{
+		ui->pushButtonDeduplicateSelected->setText("Cancel deduplication");
+	});
+	connect(_deduplicator, &Deduplicator::finished, this, [this]()
+	{
+		ui->pushButtonDeduplicateSelected->setText("Deduplicate Selected");
+	});
+
 	connect(_model, &QAbstractItemModel::dataChanged, this, &MainWindow::onDataChanged);
 	connect(_model, &QAbstractItemModel::modelReset, this, &MainWindow::updateSelectedLabel);
 	connect(_model, &QAbstractItemModel::rowsInserted, this, &MainWindow::updateSelectedLabel);
 	connect(_model, &QAbstractItemModel::rowsRemoved, this, &MainWindow::updateSelectedLabel);
+	connect(_model, &QAbstractItemModel::layoutChanged, this, &MainWindow::updateSelectedLabel);
+
+	// Expanding everything would lay out every row, only the fetched groups are expanded
+	connect(_model, &QAbstractItemModel::rowsInserted, this, [this](const QModelIndex& parent, int first, int last)
+	{
+		if (parent.isValid())
+		{
+			return;
+		}
+
+		for (int row = first; row <= last; ++row)
+		{
+			ui->treeViewResults->expand(_model->index(row, 0));
+		}
+	});
+
+	// A sort moves groups into the fetched rows which were not expanded yet
+	connect(_model, &QAbstractItemModel::layoutChanged, this, [this]()
+	{
+		ui->treeViewResults->expandToDepth(0);
+	});
+	connect(_model, &QAbstractItemModel::modelReset, this, [this]()
+	{
+		ui->treeViewResults->expandToDepth(0);
+	});
 
 	initMenuBar();
 	initHashCalculator();
@@ -107,36 +189,52 @@ void MainWindow::onFindDuplicates()
 		onFindDuplicates();
 	}
 
-	if (!QDir(selectedDirectory).exists())
+	const QStringList directories = selectedDirectory.split('|', Qt::SkipEmptyParts);
+
+	for (const QString& directory : directories)
 	{
-		QMessageBox::warning(this, "Selected directory", '"' + selectedDirectory + '"' + " does not appear to exist!");
-		onOpenDirectoryDialog();
-		return;
+		if (!QDir(directory).exists())
+		{
+			QMessageBox::warning(this, "Selected directory", '"' + directory + '"' + " does not appear to exist!");
+			onOpenDirectoryDialog();
+			return;
+		}
 	}
 
-	populateTree(selectedDirectory);
+	populateTree(directories);
 }
 
-void MainWindow::onProcessing(const QString& filePath, qint64 bytesRead, qint64 bytesLeft)
+void MainWindow::onProgress()
 {
+	const ScanProgress::Snapshot progress = _hashCalculator->progress();
+	const qint64 timeLeft = progress.estimatedTimeLeft();
+
 	const QString message =
-			QString("%1 Processing: %2 %3/%4")
+		QString("%1 Found %2 files (%3/s), resolved %4/%5 candidates, read %6/s, %7 left, ETA %8: %9")
 			.arg(QTime::currentTime().toString())
-			.arg(filePath)
-			.arg(locale().formattedDataSize(bytesRead))
-			.arg(locale().formattedDataSize(bytesLeft));
+			.arg(progress.value(ScanProgress::FilesFound))
+			.arg(progress.rate(ScanProgress::FilesFound, _lastProgress))
+			.arg(progress.value(ScanProgress::ResolvedFiles))
+			.arg(progress.value(ScanProgress::Candidates))
+			.arg(locale().formattedDataSize(progress.rate(ScanProgress::BytesRead, _lastProgress)))
+			.arg(locale().formattedDataSize(progress.bytesRemaining()))
+			.arg(timeLeft < 0 ? "unknown" : formatDuration(timeLeft))
+			.arg(progress.currentPath);
+
+	_lastProgress = progress;
 
 	ui->statusBar->setPalette(windowTextPalette(Qt::darkCyan));
 	ui->statusBar->showMessage(message);
 }
 
-void MainWindow::onDuplicateFound(const QString& hashString, const QString& filePath)
+void MainWindow::onDuplicatesFound(const DuplicateList& duplicates)
 {
 	const QString message =
-		QString("%1 Found duplicate: %2 -> %3")
+		QString("%1 Found %2 duplicate(s), latest: %3 -> %4")
 			.arg(QTime::currentTime().toString())
-			.arg(filePath)
-			.arg(hashString);
+			.arg(duplicates.size())
+			.arg(duplicates.last().filePath)
+			.arg(duplicates.last().hash);
 
 	ui->statusBar->setPalette(windowTextPalette(Qt::darkYellow));
 	ui->statusBar->showMessage(message);
@@ -144,6 +242,8 @@ void MainWindow::onDuplicateFound(const QString& hashString, const QString& file
 
 void MainWindow::onFinished()
 {
+	_progressTimer->stop();
+
 	if (_model->rowCount() <= 0)
 	{
 		QMessageBox::information(
@@ -153,7 +253,11 @@ void MainWindow::onFinished()
 	}
 
 	ui->menuAlgorithm->setEnabled(true);
-	ui->treeViewResults->expandAll();
+	ui->menuReading->setEnabled(true);
+
+	// The groups are appended as they are found, so the order is restored once all are in
+	const QHeaderView* header = ui->treeViewResults->header();
+	ui->treeViewResults->sortByColumn(header->sortIndicatorSection(), header->sortIndicatorOrder());
 
 	const QString message =
 		QString("%1 Finished searching: %2")
@@ -170,11 +274,11 @@ void MainWindow::onFailure(const QString& filePath, HashCalculator::ErrorType er
 		QString("%1 Failed to process %2. Reason: %3")
 			.arg(QTime::currentTime().toString())
 			.arg(filePath)
-			.arg(reason(error));
+			.arg(HashCalculator::reason(error));
 
 	ui->statusBar->setPalette(windowTextPalette(Qt::red));
 	ui->statusBar->showMessage(message);
-	qWarning() << filePath << char(error);
+	qWarning() << filePath << HashCalculator::reason(error);
 }
 
 void MainWindow::onDataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>& roles)
@@ -187,13 +291,47 @@ void MainWindow::onDataChanged(const QModelIndex&, const QModelIndex&, const QVe
 
 void MainWindow::onRefresh()
 {
-	_model->removeInexistentPaths();
-	ui->treeViewResults->expandAll();
-	updateSelectedLabel();
+	if (_pathChecker->isRunning())
+	{
+		_pathChecker->requestInterruption();
+		return;
+	}
+
+	const QStringList filePaths = _model->paths();
+
+	const QString message =
+		QString("%1 Checking %2 file(s) for existence")
+			.arg(QTime::currentTime().toString())
+			.arg(filePaths.size());
+
+	ui->statusBar->setPalette(windowTextPalette(Qt::darkCyan));
+	ui->statusBar->showMessage(message);
+
+	_pathChecker->setPaths(filePaths);
+	_pathChecker->start();
+}
+
+void MainWindow::onMissingPathsFound(const QStringList& filePaths)
+{
+	_model->removePaths(filePaths);
+
+	const QString message =
+		QString("%1 Removed %2 file(s) which do not exist anymore")
+			.arg(QTime::currentTime().toString())
+			.arg(filePaths.size());
+
+	ui->statusBar->setPalette(windowTextPalette(Qt::darkGreen));
+	ui->statusBar->showMessage(message);
 }
 
 void MainWindow::deleteSelected()
 {
+	if (_fileRemover->isRunning())
+	{
+		_fileRemover->requestInterruption();
+		return;
+	}
+
 	const QStringList filePaths = _model->selectedPaths();
 
 	if (filePaths.empty())
@@ -212,23 +350,83 @@ void MainWindow::deleteSelected()
 		return;
 	}
 
-	for (const QString& filePath : filePaths)
+	// Before the thread starts, so that its end is never seen before its start
+	emit removalStarting();
+	_fileRemover->setPaths(filePaths);
+	_fileRemover->start();
+}
+
+void MainWindow::onFilesRemoved(const QStringList& filePaths)
+{
+	_model->removePaths(filePaths);
+
+	const QString message =
+		QString("%1 Deleted %2 / %3 file(s)")
+			.arg(QTime::currentTime().toString())
+			.arg(_fileRemover->processedCount())
+			.arg(_fileRemover->pathCount());
+
+	ui->statusBar->setPalette(windowTextPalette(Qt::darkCyan));
+	ui->statusBar->showMessage(message);
+}
+
+void MainWindow::onRemovalFailed(const QStringList& failures)
+{
+	constexpr int MaxLines = 20;
+
+	QString text = failures.mid(0, MaxLines).join('\n');
+
+	if (failures.size() > MaxLines)
 	{
-		if (!QFile::remove(filePath))
-		{
-			if (QFile::exists(filePath))
-			{
-				QMessageBox::warning(this, "Failed to remove file", "Failed to remove:\n\n" + filePath + "\n");
-				continue;
-			}
+		text += QString("\n\n...and %1 more").arg(failures.size() - MaxLines);
+	}
 
-			QMessageBox::warning(this, "Failed to remove file", filePath + "\n\ndoes not exist anymore!\n");
-		}
+	QMessageBox::warning(this, "Failed to remove files", QString("Failed to remove %1 file(s):\n\n").arg(failures.size()) + text + "\n");
+}
+
+void MainWindow::deduplicateSelected()
+{
+	if (_deduplicator->isRunning())
+	{
+		_deduplicator->requestInterruption();
+		return;
+	}
+
+	const QList<QStringList> groups = _model->selectedGroups();
+
+	if (groups.empty())
+	{
+		QMessageBox::warning(this, "Failed to deduplicate", "Nothing selected!\n");
+		return;
+	}
+
+	const QString message =
+		QString("Are you sure you want the selected files in %1 group(s) to share storage with an unselected duplicate?\n\n"
+			"Where the filesystem cannot share extents, the selected files are replaced by hard links.")
+			.arg(groups.size());
 
-		_model->removePath(filePath);
+	if (QMessageBox::question(this, "Confirm deduplication?", message) !=
+		QMessageBox::StandardButton::Yes)
+	{
+		return;
 	}
 
-	ui->treeViewResults->expandAll();
+	emit deduplicationStarting();
+	_deduplicator->setGroups(groups);
+	_deduplicator->start();
+}
+
+void MainWindow::onDeduplicated(const QStringList& report, const QStringList& sharedPaths, qint64 bytesShared)
+{
+	// Deleting a shared file frees nothing anymore, nor would deduplicating it again
+	_model->markShared(sharedPaths);
+	updateSelectedLabel();
+
+	QMessageBox box(QMessageBox::Information, "Deduplication finished",
+		QString("%1 now shared.\n").arg(locale().formattedDataSize(bytesShared)), QMessageBox::Ok, this);
+
+	box.setDetailedText(report.join('\n'));
+	box.exec();
 }
 
 void MainWindow::initMenuBar()
@@ -253,27 +451,77 @@ void MainWindow::initMenuBar()
 	algorithmGroup->addAction(ui->actionSHA_1);
 	algorithmGroup->addAction(ui->actionSHA_256);
 	algorithmGroup->addAction(ui->actionSHA_512);
+	algorithmGroup->addAction(ui->actionFast128);
 	algorithmGroup->setExclusive(true);
 
 	connect(ui->actionMD5, &QAction::triggered,
-		std::bind(&HashCalculator::setAlgorithm, _hashCalculator, QCryptographicHash::Algorithm::Md5));
+		std::bind(&HashCalculator::setAlgorithm, _hashCalculator, Hasher::Algorithm::Md5));
 	connect(ui->actionSHA_1, &QAction::triggered,
-		std::bind(&HashCalculator::setAlgorithm, _hashCalculator, QCryptographicHash::Algorithm::Sha1));
+		std::bind(&HashCalculator::setAlgorithm, _hashCalculator, Hasher::Algorithm::Sha1));
 	connect(ui->actionSHA_256, &QAction::triggered,
-		std::bind(&HashCalculator::setAlgorithm, _hashCalculator, QCryptographicHash::Algorithm::Sha256));
+		std::bind(&HashCalculator::setAlgorithm, _hashCalculator, Hasher::Algorithm::Sha256));
 	connect(ui->actionSHA_512, &QAction::triggered,
-		std::bind(&HashCalculator::setAlgorithm, _hashCalculator, QCryptographicHash::Algorithm::Sha512));
+		std::bind(&HashCalculator::setAlgorithm, _hashCalculator, Hasher::Algorithm::Sha512));
+	connect(ui->actionFast128, &QAction::triggered,
+		std::bind(&HashCalculator::setAlgorithm, _hashCalculator, Hasher::Algorithm::Fast128));
+
+	// Only meaningful for the non-cryptographic hash
+	connect(ui->actionConfirmWithSHA_256, &QAction::toggled, _hashCalculator, &HashCalculator::setConfirmation);
+	connect(ui->actionCacheHashes, &QAction::toggled, _hashCalculator, &HashCalculator::setCacheEnabled);
+	connect(ui->actionCompareBytes, &QAction::toggled, _hashCalculator, &HashCalculator::setComparison);
 
 	ui->actionSHA_256->setChecked(true);
+
+	auto readModeGroup = new QActionGroup(this);
+	readModeGroup->addAction(ui->actionReadBuffered);
+	readModeGroup->addAction(ui->actionReadMapped);
+	readModeGroup->addAction(ui->actionReadDirect);
+	readModeGroup->addAction(ui->actionReadUring);
+	readModeGroup->setExclusive(true);
+
+	connect(ui->actionReadBuffered, &QAction::triggered,
+		std::bind(&HashCalculator::setReadMode, _hashCalculator, FileReader::Mode::Buffered));
+	connect(ui->actionReadMapped, &QAction::triggered,
+		std::bind(&HashCalculator::setReadMode, _hashCalculator, FileReader::Mode::MemoryMapped));
+	connect(ui->actionReadDirect, &QAction::triggered,
+		std::bind(&HashCalculator::setReadMode, _hashCalculator, FileReader::Mode::Direct));
+	connect(ui->actionReadUring, &QAction::triggered,
+		std::bind(&HashCalculator::setReadMode, _hashCalculator, FileReader::Mode::Asynchronous));
+
+	ui->actionReadBuffered->setChecked(true);
+
+	connect(ui->actionReadUring, &QAction::toggled, ui->actionQueueDepth, &QAction::setEnabled);
+	connect(ui->actionQueueDepth, &QAction::triggered, [this]()
+	{
+		bool accepted = false;
+
+		const int queueDepth = QInputDialog::getInt(
+			this,
+			"io_uring queue depth",
+			"Reads in flight per hashing thread:",
+			_hashCalculator->queueDepth(),
+			1,
+			HashCalculator::MaxQueueDepth,
+			1,
+			&accepted);
+
+		if (accepted)
+		{
+			_hashCalculator->setQueueDepth(queueDepth);
+		}
+	});
 }
 
 void MainWindow::initHashCalculator()
 {
 	qRegisterMetaType<HashCalculator::ErrorType>("ErrorType");
+	qRegisterMetaType<DuplicateList>("DuplicateList");
 
-	connect(_hashCalculator, &HashCalculator::processing, this, &MainWindow::onProcessing);
-	connect(_hashCalculator, &HashCalculator::duplicateFound, _model, &ResultModel::addPath);
-	connect(_hashCalculator, &HashCalculator::duplicateFound, this, &MainWindow::onDuplicateFound);
+	// The engine only counts, the status bar is refreshed at a fixed rate
+	_progressTimer->setInterval(250);
+	connect(_progressTimer, &QTimer::timeout, this, &MainWindow::onProgress);
+	connect(_hashCalculator, &HashCalculator::duplicatesFound, _model, &ResultModel::addPaths);
+	connect(_hashCalculator, &HashCalculator::duplicatesFound, this, &MainWindow::onDuplicatesFound);
 	connect(_hashCalculator, &HashCalculator::finished, this, &MainWindow::onFinished);
 	connect(_hashCalculator, &HashCalculator::failure, this, &MainWindow::onFailure);
 }
@@ -284,8 +532,10 @@ void MainWindow::initStateMachine()
 	emptyState->assignProperty(ui->pushButtonFindDuplicates, "enabled", false);
 	emptyState->assignProperty(ui->pushButtonRefresh, "enabled", false);
 	emptyState->assignProperty(ui->pushButtonDeleteSelected, "enabled", false);
+	emptyState->assignProperty(ui->pushButtonDeduplicateSelected, "enabled", false);
 	emptyState->assignProperty(ui->lineEditSelectedDirectory, "enabled", true);
 	emptyState->assignProperty(ui->treeViewResults, "enabled", false);
+	emptyState->assignProperty(ui->actionOpen, "enabled", true);
 	emptyState->setObjectName("empty");
 
 	auto readyState = new QState();
@@ -293,23 +543,50 @@ void MainWindow::initStateMachine()
 	readyState->assignProperty(ui->pushButtonFindDuplicates, "enabled", true);
 	readyState->assignProperty(ui->pushButtonRefresh, "enabled", true);
 	readyState->assignProperty(ui->pushButtonDeleteSelected, "enabled", true);
+	readyState->assignProperty(ui->pushButtonDeduplicateSelected, "enabled", true);
 	readyState->assignProperty(ui->lineEditSelectedDirectory, "enabled", true);
 	readyState->assignProperty(ui->treeViewResults, "enabled", true);
+	readyState->assignProperty(ui->actionOpen, "enabled", true);
 	readyState->setObjectName("ready");
 
 	auto runningState = new QState();
 	runningState->assignProperty(ui->pushButtonFindDuplicates, "text", "Cancel");
 	runningState->assignProperty(ui->pushButtonRefresh, "enabled", false);
 	runningState->assignProperty(ui->pushButtonDeleteSelected, "enabled", false);
+	runningState->assignProperty(ui->pushButtonDeduplicateSelected, "enabled", false);
 	runningState->assignProperty(ui->lineEditSelectedDirectory, "enabled", false);
 	runningState->assignProperty(ui->treeViewResults, "enabled", false);
 	runningState->setObjectName("running");
 
+	// While files are deleted or relinked, nothing else may touch them or the results.
+	// Only the button of the job stays enabled, to cancel it.
+	auto removingState = new QState();
+	removingState->assignProperty(ui->pushButtonFindDuplicates, "enabled", false);
+	removingState->assignProperty(ui->pushButtonRefresh, "enabled", false);
+	removingState->assignProperty(ui->pushButtonDeleteSelected, "enabled", true);
+	removingState->assignProperty(ui->pushButtonDeduplicateSelected, "enabled", false);
+	removingState->assignProperty(ui->lineEditSelectedDirectory, "enabled", false);
+	removingState->assignProperty(ui->actionOpen, "enabled", false);
+	removingState->setObjectName("removing");
+
+	auto deduplicatingState = new QState();
+	deduplicatingState->assignProperty(ui->pushButtonFindDuplicates, "enabled", false);
+	deduplicatingState->assignProperty(ui->pushButtonRefresh, "enabled", false);
+	deduplicatingState->assignProperty(ui->pushButtonDeleteSelected, "enabled", false);
+	deduplicatingState->assignProperty(ui->pushButtonDeduplicateSelected, "enabled", true);
+	deduplicatingState->assignProperty(ui->lineEditSelectedDirectory, "enabled", false);
+	deduplicatingState->assignProperty(ui->actionOpen, "enabled", false);
+	deduplicatingState->setObjectName("deduplicating");
+
 	emptyState->addTransition(this, &MainWindow::inputReady, readyState);
 	readyState->addTransition(this, &MainWindow::inputIncomplete, emptyState);
 	readyState->addTransition(ui->pushButtonFindDuplicates, &QAbstractButton::clicked, runningState);
+	readyState->addTransition(this, &MainWindow::removalStarting, removingState);
+	readyState->addTransition(this, &MainWindow::deduplicationStarting, deduplicatingState);
 	runningState->addTransition(_hashCalculator, &HashCalculator::finished, readyState);
 	runningState->addTransition(ui->pushButtonFindDuplicates, &QAbstractButton::clicked, readyState);
+	removingState->addTransition(_fileRemover, &FileRemover::finished, readyState);
+	deduplicatingState->addTransition(_deduplicator, &Deduplicator::finished, readyState);
 
 	connect(readyState, &QState::entered, _hashCalculator, &QThread::requestInterruption);
 	connect(runningState, &QState::entered, this, &MainWindow::onFindDuplicates);
@@ -317,6 +594,8 @@ void MainWindow::initStateMachine()
 	_machine.addState(emptyState);
 	_machine.addState(readyState);
 	_machine.addState(runningState);
+	_machine.addState(removingState);
+	_machine.addState(deduplicatingState);
 	_machine.setInitialState(emptyState);
 	_machine.start();
 }
@@ -332,18 +611,20 @@ void MainWindow::processCommandLine()
 	}
 }
 
-void MainWindow::populateTree(const QString& directory)
+void MainWindow::populateTree(const QStringList& directories)
 {
+	// The check results would be about the previous results
+	_pathChecker->requestInterruption();
 	_model->clear();
 	ui->menuAlgorithm->setEnabled(false);
-	_hashCalculator->setDirectory(directory);
+	ui->menuReading->setEnabled(false);
+	_hashCalculator->setDirectories(directories);
 
-	if (!ui->lineEditWildcards->text().isEmpty())
-	{
-		_hashCalculator->setWildcards(ui->lineEditWildcards->text());
-	}
+	_hashCalculator->setWildcards(ui->lineEditWildcards->text());
 
+	_lastProgress = {};
 	_hashCalculator->start();
+	_progressTimer->start();
 }
 
 void MainWindow::updateSelectedLabel()
@@ -365,7 +646,7 @@ void MainWindow::createFileContextMenu(const QPoint& pos)
 		return;
 	}
 
-	const QVariant variant = _model->data(selection, Qt::DisplayRole);
+	const QVariant variant = _model->data(selection.siblingAtColumn(ResultModel::PathColumn), Qt::DisplayRole);
 
 	if (!variant.isValid())
 	{
@@ -388,6 +669,7 @@ void MainWindow::createFileContextMenu(const QPoint& pos)
 	connect(openParentDirAction, &QAction::triggered, std::bind(&MainWindow::openParentDirectory, this, filePath));
 
 	auto removeFileAction = new QAction("Delete file", this);
+	removeFileAction->setEnabled(!_fileRemover->isRunning() && !_deduplicator->isRunning());
 	connect(removeFileAction, &QAction::triggered, std::bind(&MainWindow::removeFile, this, filePath));
 
 	QMenu menu(this);
@@ -439,7 +721,6 @@ bool MainWindow::removeFile(const QString& filePath)
 	}
 
 	_model->removePath(filePath);
-	ui->treeViewResults->expandAll();
 	return true;
 }
 
@@ -1,10 +1,12 @@
 #pragma once
 
 #include <QMainWindow>
-#include <QCryptographicHash>
 #include <QStateMachine>
 
+#include "Deduplicator.hpp"
+#include "FileRemover.hpp"
 #include "HashCalculator.hpp"
+#include "PathChecker.hpp"
 
 namespace Ui
 {
@@ -12,6 +14,7 @@ namespace Ui
 }
 
 class ResultModel;
+class QTimer;
 
 class MainWindow : public QMainWindow
 {
@@ -24,25 +27,32 @@ public:
 private slots:
 	void onOpenDirectoryDialog();
 	void onFindDuplicates();
-	void onProcessing(const QString& filePath, qint64 bytesRead, qint64 bytesLeft);
-	void onDuplicateFound(const QString& hashString, const QString& filePath);
+	void onProgress();
+	void onDuplicatesFound(const DuplicateList& duplicates);
 	void onFinished();
 	void onFailure(const QString& filePath, HashCalculator::ErrorType error);
 	void onDataChanged(const QModelIndex&, const QModelIndex&, const QVector<int>& roles);
 	void onRefresh();
+	void onMissingPathsFound(const QStringList& filePaths);
 	void deleteSelected();
+	void onFilesRemoved(const QStringList& filePaths);
+	void onRemovalFailed(const QStringList& failures);
+	void deduplicateSelected();
+	void onDeduplicated(const QStringList& report, const QStringList& sharedPaths, qint64 bytesShared);
 	void onAbout();
 
 signals:
 	void inputReady();
 	void inputIncomplete();
+	void removalStarting();
+	void deduplicationStarting();
 
 private:
 	void initMenuBar();
 	void initHashCalculator();
 	void initStateMachine();
 	void processCommandLine();
-	void populateTree(const QString& directory);
+	void populateTree(const QStringList& directories);
 	void updateSelectedLabel();
 	void createFileContextMenu(const QPoint& pos);
 	void openFileWithDefaultAssociation(const QString& filePath);
@@ -51,6 +61,11 @@ private:
 
 	Ui::MainWindow* ui;
 	HashCalculator* _hashCalculator;
+	PathChecker* _pathChecker;
+	FileRemover* _fileRemover;
+	Deduplicator* _deduplicator;
 	ResultModel* _model;
+	QTimer* _progressTimer;
+	ScanProgress::Snapshot _lastProgress;
 	QStateMachine _machine;
 };
@@ -0,0 +1,72 @@
+#include "PathChecker.hpp"
+
+#include <QDebug>
+#include <QElapsedTimer>
+#include <QFileInfo>
+
+PathChecker::PathChecker(QObject* parent) :
+	QThread(parent)
+{
+	_pool.setMaxThreadCount(QThread::idealThreadCount() * ThreadsPerCore);
+}
+
+PathChecker::~PathChecker()
+{
+	requestInterruption();
+	wait();
+}
+
+void PathChecker::setPaths(const QStringList& filePaths)
+{
+	_filePaths = filePaths;
+}
+
+bool PathChecker::keepRunning() const
+{
+	// Called from the worker threads too, hence not QThread::currentThread()
+	return isInterruptionRequested() == false;
+}
+
+void PathChecker::checkPaths()
+{
+	QStringList missingPaths;
+
+	for (qsizetype i = _next++; i < _filePaths.size() && keepRunning(); i = _next++)
+	{
+		if (!QFileInfo::exists(_filePaths.at(i)))
+		{
+			missingPaths.append(_filePaths.at(i));
+		}
+	}
+
+	QMutexLocker lock(&_mutex);
+	_missingPaths.append(missingPaths);
+}
+
+void PathChecker::run()
+{
+	QElapsedTimer timer;
+	timer.start();
+
+	_next = 0;
+	_missingPaths.clear();
+
+	const int threadCount = qMin<qsizetype>(_pool.maxThreadCount(), _filePaths.size());
+
+	for (int i = 0; i < threadCount; ++i)
+	{
+		_pool.start(std::bind(&PathChecker::checkPaths, this));
+	}
+
+	_pool.waitForDone();
+
+	if (!keepRunning())
+	{
+		qDebug() << "Interrupted after" << timer.elapsed() << "ms";
+		return;
+	}
+
+	qDebug() << "Checked" << _filePaths.size() << "paths in" << timer.elapsed() << "ms," << _missingPaths.size() << "missing";
+
+	emit missingPathsFound(_missingPaths);
+}
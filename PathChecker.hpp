@@ -0,0 +1,39 @@
+#pragma once
+
+#include <QMutex>
+#include <QStringList>
+#include <QThread>
+#include <QThreadPool>
+
+#include <atomic>
+
+// Finds out which of the given paths do not exist anymore.
+// The stat calls are mostly waiting for the storage, so they are issued from several threads at once
+class PathChecker : public QThread
+{
+	Q_OBJECT
+
+public:
+	PathChecker(QObject* parent);
+	~PathChecker();
+
+	void setPaths(const QStringList& filePaths);
+
+signals:
+	// Not emitted when interrupted
+	void missingPathsFound(const QStringList& filePaths);
+
+private:
+	// Stat calls are latency bound, more of them in flight than there are cores
+	static constexpr int ThreadsPerCore = 4;
+
+	bool keepRunning() const;
+	void checkPaths();
+	void run() override;
+
+	QThreadPool _pool;
+	QStringList _filePaths;
+	std::atomic<qsizetype> _next = 0;
+	QMutex _mutex;
+	QStringList _missingPaths;
+};
@@ -0,0 +1,138 @@
+#include "PathFilter.hpp"
+
+#include <QDebug>
+
+void PathFilter::setPatterns(const QString& patterns)
+{
+	_includes = {};
+	_excludes = {};
+	_excludedDirectories = {};
+
+	for (QString pattern : patterns.split('|', Qt::SkipEmptyParts))
+	{
+		const bool excluded = pattern.startsWith('!');
+		const bool directory = pattern.endsWith('/');
+
+		if (excluded)
+		{
+			pattern.remove(0, 1);
+		}
+
+		if (directory)
+		{
+			pattern.chop(1);
+		}
+
+		if (pattern.isEmpty())
+		{
+			continue;
+		}
+
+		if (directory)
+		{
+			// Including directories by name would need a second notion of depth, only pruning is supported
+			_excludedDirectories.add(pattern);
+		}
+		else
+		{
+			(excluded ? _excludes : _includes).add(pattern);
+		}
+	}
+
+	_includes.compile();
+	_excludes.compile();
+	_excludedDirectories.compile();
+}
+
+void PathFilter::setSizeRange(qint64 minimum, qint64 maximum)
+{
+	_minimumSize = qMax<qint64>(0, minimum);
+	_maximumSize = maximum > 0 ? maximum : std::numeric_limits<qint64>::max();
+}
+
+void PathFilter::setModifiedRange(qint64 earliest, qint64 latest)
+{
+	_earliest = earliest;
+	_latest = latest;
+}
+
+bool PathFilter::includesDirectory(const QString& directoryName) const
+{
+	return !_excludedDirectories.matches(directoryName);
+}
+
+bool PathFilter::includesFileName(const QString& fileName) const
+{
+	if (!_includes.isEmpty() && !_includes.matches(fileName))
+	{
+		return false;
+	}
+
+	return !_excludes.matches(fileName);
+}
+
+bool PathFilter::includesMetadata(qint64 size, qint64 modified) const
+{
+	return size >= _minimumSize && size <= _maximumSize && modified >= _earliest && modified <= _latest;
+}
+
+void PathFilter::Matcher::add(const QString& pattern)
+{
+	// "*.jpg", but not "*.tar.gz" nor "*.jp?"
+	const QString suffix = pattern.mid(1);
+	const bool plainSuffix = pattern.startsWith('*') && suffix.startsWith('.') && suffix.count('.') == 1 &&
+		!suffix.contains('*') && !suffix.contains('?') && !suffix.contains('[');
+
+	if (plainSuffix)
+	{
+		suffixes.insert(suffix.toLower());
+		return;
+	}
+
+	wildcards.append(pattern);
+}
+
+void PathFilter::Matcher::compile()
+{
+	if (wildcards.isEmpty())
+	{
+		expression = QRegularExpression();
+		return;
+	}
+
+	QStringList alternatives;
+
+	for (const QString& wildcard : wildcards)
+	{
+		alternatives.append(QRegularExpression::wildcardToRegularExpression(wildcard));
+	}
+
+	expression.setPattern(alternatives.join('|'));
+	expression.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
+	expression.optimize();
+
+	if (!expression.isValid())
+	{
+		qWarning() << "Invalid pattern" << wildcards << expression.errorString();
+	}
+}
+
+bool PathFilter::Matcher::isEmpty() const
+{
+	return suffixes.isEmpty() && wildcards.isEmpty();
+}
+
+bool PathFilter::Matcher::matches(const QString& name) const
+{
+	if (!suffixes.isEmpty())
+	{
+		const qsizetype dot = name.lastIndexOf('.');
+
+		if (dot >= 0 && suffixes.contains(name.mid(dot).toLower()))
+		{
+			return true;
+		}
+	}
+
+	return !wildcards.isEmpty() && expression.match(name).hasMatch();
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <QRegularExpression>
+#include <QSet>
+#include <QString>
+
+#include <limits>
+
+// Decides which files a scan looks at, as early as possible: directories by name before they are entered,
+// files by name before they are stat'ed and by size and modification time before they are opened.
+//
+// Patterns are pipe separated wildcards matched case insensitively against names, e.g. "*.jpg|*.png".
+// A pattern starting with '!' excludes matching files. A pattern ending with '/' names directories
+// which are never entered, e.g. "!.git/|!node_modules/". Without include patterns every file is included.
+class PathFilter
+{
+public:
+	void setPatterns(const QString& patterns);
+	void setSizeRange(qint64 minimum, qint64 maximum);
+	// Seconds since the epoch
+	void setModifiedRange(qint64 earliest, qint64 latest);
+
+	bool includesDirectory(const QString& directoryName) const;
+	bool includesFileName(const QString& fileName) const;
+	bool includesMetadata(qint64 size, qint64 modified) const;
+
+private:
+	// Plain "*.ext" patterns are looked up as suffixes, the rest are combined into one expression
+	struct Matcher
+	{
+		void add(const QString& pattern);
+		void compile();
+		bool isEmpty() const;
+		bool matches(const QString& name) const;
+
+		QSet<QString> suffixes;
+		QStringList wildcards;
+		QRegularExpression expression;
+	};
+
+	Matcher _includes;
+	Matcher _excludes;
+	Matcher _excludedDirectories;
+	qint64 _minimumSize = 0;
+	qint64 _maximumSize = std::numeric_limits<qint64>::max();
+	qint64 _earliest = std::numeric_limits<qint64>::min();
+	qint64 _latest = std::numeric_limits<qint64>::max();
+};
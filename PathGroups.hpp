@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QHash>
+#include <QMutex>
+#include <QStringList>
+
+// Thread safe grouping of file paths, or of what describes the files, by a key, e.g. a hash
+template <typename Key, typename Value = QString>
+class PathGroups
+{
+public:
+	// Returns the values which became part of a group of two or more by this insertion:
+	// both values when a group forms, otherwise only the inserted value or nothing
+	QList<Value> insert(const Key& key, const Value& value)
+	{
+		QMutexLocker lock(&_mutex);
+		QList<Value>& values = _groups[key];
+		values.append(value);
+
+		if (values.size() == 2)
+		{
+			return values;
+		}
+
+		if (values.size() > 2)
+		{
+			return { value };
+		}
+
+		return {};
+	}
+
+	// The groups of two or more values by their key
+	QHash<Key, QList<Value>> groups()
+	{
+		QMutexLocker lock(&_mutex);
+		QHash<Key, QList<Value>> results;
+
+		for (auto it = _groups.cbegin(); it != _groups.cend(); ++it)
+		{
+			if (it.value().size() > 1)
+			{
+				results.insert(it.key(), it.value());
+			}
+		}
+
+		return results;
+	}
+
+	void clear()
+	{
+		QMutexLocker lock(&_mutex);
+		_groups.clear();
+	}
+
+private:
+	QMutex _mutex;
+	QHash<Key, QList<Value>> _groups;
+};
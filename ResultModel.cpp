@@ -1,326 +1,532 @@
 #include "ResultModel.hpp"
 
+#include <QColor>
+#include <QLocale>
 #include <QDebug>
-#include <QFile>
-#include <QVector>
+#include <algorithm>
+#include <functional>
+#include <utility>
 
-inline Node* indexToNode(const QModelIndex& index)
+ResultModel::ResultModel(QObject *parent) :
+	QAbstractItemModel(parent)
+{
+}
+
+ResultModel::~ResultModel()
 {
-	return static_cast<Node*>(index.internalPointer());
 }
 
-class Node
+QModelIndex ResultModel::index(int row, int column, const QModelIndex& parentIndex) const
 {
-public:
-	Node(Node* parent, const QMap<Qt::ItemDataRole, QVariant>& data) :
-		_parent(parent),
-		_data(data)
+	if (!hasIndex(row, column, parentIndex))
 	{
+		return QModelIndex();
 	}
 
-	~Node()
+	if (!parentIndex.isValid())
 	{
-		qDeleteAll(_children);
-		qDebug() << _data[Qt::DisplayRole];
+		return createIndex(row, column, GroupId);
 	}
 
-	const Node* parent() const
+	return createIndex(row, column, quintptr(groupAt(parentIndex).entries.at(row)));
+}
+
+QModelIndex ResultModel::parent(const QModelIndex& childIndex) const
+{
+	if (!childIndex.isValid() || isGroup(childIndex))
 	{
-		return _parent;
+		return QModelIndex();
 	}
 
-	Node* childAt(int index) const
+	const Entry& entry = _entries[childIndex.internalId()];
+	return createIndex(_groups[entry.group].row, 0, GroupId);
+}
+
+int ResultModel::rowCount(const QModelIndex& parentIndex) const
+{
+	if (!parentIndex.isValid())
 	{
-		return _children.at(index);
+		return _fetchedCount;
 	}
 
-	Node* takeChild(int index)
+	return isGroup(parentIndex) && parentIndex.column() == HashColumn ?
+		groupAt(parentIndex).entries.size() :
+		0;
+}
+
+int ResultModel::columnCount(const QModelIndex&) const
+{
+	return ColumnCount;
+}
+
+QVariant ResultModel::data(const QModelIndex& index, int role) const
+{
+	if (!index.isValid())
 	{
-		return _children.takeAt(index);
+		return QVariant();
 	}
 
-	QVector<Node*> takeChildren(const std::function<bool(const Node*)>& predicate)
+	if (isGroup(index))
 	{
-		QVector<Node*> result;
+		const Group& group = groupAt(index);
 
-		int i = childCount();
-
-		while (i--)
+		if (role == Qt::DisplayRole)
 		{
-			if (predicate(childAt(i)))
+			switch (index.column())
 			{
-				result.append(takeChild(i));
+				case HashColumn:
+					return group.hash.toString();
+				case SizeColumn:
+					return QLocale().formattedDataSize(group.size);
+				case CountColumn:
+					return group.entries.size();
+				case ReclaimableColumn:
+					return QLocale().formattedDataSize(reclaimable(group));
 			}
-		}
-
-		return result;
-	}
-
-	Node* appendChild(const QMap<Qt::ItemDataRole, QVariant>& data)
-	{
-		Node* child = new Node(this, data);
-		_children.append(child);
-		return child;
-	}
 
-	QVector<Node*> findChildren(const std::function<bool(const Node*)>& predicate) const
-	{
-		QVector<Node*> results;
-		QVector<Node*> stack;
-		stack.append(const_cast<Node*>(this));
+			return QVariant();
+		}
 
-		while (!stack.isEmpty())
+		if (role == Qt::TextAlignmentRole && index.column() >= SizeColumn)
 		{
-			Node* node = stack.takeLast();
-
-			stack.append(node->_children);
+			return int(Qt::AlignRight | Qt::AlignVCenter);
+		}
 
-			if (predicate(node))
-			{
-				results.append(node);
-			}
+		// Hard links are already deduplicated, deleting one does not free any space
+		if (role == Qt::ForegroundRole && group.hardlink)
+		{
+			return QColor(Qt::gray);
 		}
 
-		return results;
+		return QVariant();
 	}
 
-	Node* findChild(const std::function<bool(const Node*)>& predicate) const
+	const Entry& entry = _entries[index.internalId()];
+
+	if (role == Qt::DisplayRole && index.column() == PathColumn)
 	{
-		auto children = findChildren(predicate);
-		return children.isEmpty() ? nullptr : children.first();
+		return entry.path.toString();
 	}
 
-	int parentRow() const
+	if (role == Qt::CheckStateRole && index.column() == PathColumn && entry.checkable)
 	{
-		return _parent ? _parent->_children.indexOf(const_cast<Node*>(this)) : 0;
+		return entry.checked ? Qt::Checked : Qt::Unchecked;
 	}
 
-	int childCount() const
+	if (role == Qt::ForegroundRole && !entry.checkable)
 	{
-		return _children.size();
+		return QColor(Qt::gray);
 	}
 
-	bool hasChildren() const
+	return QVariant();
+}
+
+bool ResultModel::setData(const QModelIndex& index, const QVariant& value, int role)
+{
+	if (role != Qt::CheckStateRole || index.column() != PathColumn || isGroup(index))
 	{
-		return !_children.isEmpty();
+		return false;
 	}
 
-	QVariant value(Qt::ItemDataRole role, const QVariant& defaultValue = QVariant()) const
+	Entry& entry = _entries[index.internalId()];
+
+	if (!entry.checkable)
 	{
-		return _data.value(role, defaultValue);
+		return false;
 	}
 
-	void setValue(Qt::ItemDataRole role, const QVariant& value)
+	if (value == Qt::CheckState::Checked)
 	{
-		_data[role] = value;
+		_selectedCount += entry.checked ? 0 : 1;
+		entry.checked = true;
 	}
-
-	QString displayString() const
+	else if (value == Qt::CheckState::Unchecked)
 	{
-		return _data.value(Qt::DisplayRole).toString();
+		_selectedCount -= entry.checked ? 1 : 0;
+		entry.checked = false;
 	}
-
-	bool isChecked() const
+	else
 	{
-		return _data.value(Qt::CheckStateRole) == Qt::CheckState::Checked;
+		qDebug() << "Invalid check state value:" << value;
+		return false;
 	}
 
-private:
-	const Node* _parent;
-	QVector<Node*> _children;
-	QMap<Qt::ItemDataRole, QVariant> _data;
-};
-
+	emit dataChanged(index, index);
+	return true;
+}
 
-ResultModel::ResultModel(QObject *parent) :
-	QAbstractItemModel(parent),
-	_root(new Node(nullptr, { { Qt::DisplayRole, "root" } }))
+QVariant ResultModel::headerData(int section, Qt::Orientation orientation, int role) const
 {
+	if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+	{
+		return QVariant();
+	}
+
+	switch (section)
+	{
+		case HashColumn:
+			return "Hash";
+		case PathColumn:
+			return "Path";
+		case SizeColumn:
+			return "Size";
+		case CountColumn:
+			return "Count";
+		case ReclaimableColumn:
+			return "Reclaimable";
+	}
+
+	return QVariant();
 }
 
-ResultModel::~ResultModel()
+bool ResultModel::canFetchMore(const QModelIndex& parentIndex) const
 {
-	delete _root;
+	return !parentIndex.isValid() && _fetchedCount < _groupOrder.size();
 }
 
-QModelIndex ResultModel::index(int row, int column, const QModelIndex& parentIndex) const
+void ResultModel::fetchMore(const QModelIndex& parentIndex)
 {
-	if (!hasIndex(row, column, parentIndex))
+	if (!canFetchMore(parentIndex))
 	{
-		return QModelIndex();
+		return;
 	}
 
-	const Node* parentNode= parentIndex.isValid() ? indexToNode(parentIndex) : _root;
-	const Node* childNode = parentNode->childAt(row);
-	return childNode ? createIndex(row, column, childNode) : QModelIndex();
+	const int count = std::min(FetchBatchSize, int(_groupOrder.size()) - _fetchedCount);
+
+	beginInsertRows(QModelIndex(), _fetchedCount, _fetchedCount + count - 1);
+	_fetchedCount += count;
+	endInsertRows();
 }
 
-QModelIndex ResultModel::parent(const QModelIndex& childIndex) const
+Qt::ItemFlags ResultModel::flags(const QModelIndex& index) const
 {
-	if (!childIndex.isValid())
+	if (index.column() != PathColumn || isGroup(index) || !_entries[index.internalId()].checkable)
 	{
-		return QModelIndex();
+		return Qt::ItemIsEnabled;
 	}
 
-	const Node* parentNode = indexToNode(childIndex)->parent();
-
-	return parentNode != _root ?
-		createIndex(parentNode->parentRow(), 0, parentNode) :
-		QModelIndex();
+	return Qt::ItemIsEnabled | Qt::ItemIsUserCheckable;
 }
 
-int ResultModel::rowCount(const QModelIndex& parentIndex) const
+void ResultModel::sort(int column, Qt::SortOrder order)
 {
-	return parentIndex.isValid() ?
-		indexToNode(parentIndex)->childCount() :
-		_root->childCount();
-}
+	emit layoutAboutToBeChanged();
 
-int ResultModel::columnCount(const QModelIndex&) const
-{
-	return 2;
-}
+	// The persistent indexes are remapped through the ids, which the sort does not change
+	const QModelIndexList oldIndexes = persistentIndexList();
+	QVector<quint32> oldGroupIds;
 
-QVariant ResultModel::data(const QModelIndex& index, int role) const
-{
-	if (!index.isValid())
+	for (const QModelIndex& index : oldIndexes)
 	{
-		return QVariant();
+		oldGroupIds.append(isGroup(index) ? _groupOrder[index.row()] : 0);
 	}
 
-	const Node* item = indexToNode(index);
-	bool topLevel = item->parent() == _root;
-	bool hashCell = index.column() == 0 && topLevel;
-	bool pathCell = index.column() == 1 && !topLevel;
-
-	if (role == Qt::DisplayRole)
+	if (column < 0 || column >= ColumnCount)
+	{
+		std::sort(_groupOrder.begin(), _groupOrder.end());
+		sortEntries(std::less<quint32>());
+	}
+	else if (column == PathColumn)
 	{
-		if (hashCell || pathCell)
+		const auto byPath = [&](quint32 lhs, quint32 rhs)
 		{
-			return item->value(Qt::DisplayRole);
-		}
+			return order == Qt::AscendingOrder ?
+				_entries[lhs].path < _entries[rhs].path :
+				_entries[rhs].path < _entries[lhs].path;
+		};
+
+		sortEntries(byPath);
 	}
+	else if (column == HashColumn)
+	{
+		const auto byHash = [&](quint32 lhs, quint32 rhs)
+		{
+			return order == Qt::AscendingOrder ?
+				_groups[lhs].hash < _groups[rhs].hash :
+				_groups[rhs].hash < _groups[lhs].hash;
+		};
 
-	if (role == Qt::CheckStateRole)
+		std::stable_sort(_groupOrder.begin(), _groupOrder.end(), byHash);
+	}
+	else
 	{
-		if (pathCell)
+		// The keys are gathered next to the ids, so the sort does not chase the groups.
+		// Equal keys keep the order in which the groups were found
+		std::vector<std::pair<qint64, quint32>> keys;
+		keys.reserve(_groupOrder.size());
+
+		for (quint32 groupId : _groupOrder)
+		{
+			keys.emplace_back(sortKey(_groups[groupId], column), groupId);
+		}
+
+		const auto byKey = [order](const std::pair<qint64, quint32>& lhs, const std::pair<qint64, quint32>& rhs)
+		{
+			if (lhs.first != rhs.first)
+			{
+				return order == Qt::AscendingOrder ? lhs.first < rhs.first : lhs.first > rhs.first;
+			}
+
+			return lhs.second < rhs.second;
+		};
+
+		std::sort(keys.begin(), keys.end(), byKey);
+
+		for (size_t i = 0; i < keys.size(); ++i)
 		{
-			return item->value(Qt::CheckStateRole);
+			_groupOrder[int(i)] = keys[i].second;
 		}
 	}
 
-	return QVariant();
-}
+	for (int row = 0; row < _groupOrder.size(); ++row)
+	{
+		_groups[_groupOrder[row]].row = row;
+	}
 
-bool ResultModel::setData(const QModelIndex& index, const QVariant& value, int role)
-{
-	Node* item = indexToNode(index);
-	bool topLevel = item->parent() == _root;
-	bool pathCell = index.column() == 1 && !topLevel;
+	QModelIndexList newIndexes;
 
-	if (role == Qt::CheckStateRole && pathCell)
+	for (int i = 0; i < oldIndexes.size(); ++i)
 	{
-		if (value == Qt::CheckState::Checked)
+		const QModelIndex& index = oldIndexes[i];
+		const Group& group = isGroup(index) ?
+			_groups[oldGroupIds[i]] :
+			_groups[_entries[index.internalId()].group];
+
+		// Groups sorted past the fetched ones are no longer known to the view
+		if (!isFetched(group))
 		{
-			++_selectedCount;
+			newIndexes.append(QModelIndex());
 		}
-		else if (value == Qt::CheckState::Unchecked)
+		else if (isGroup(index))
 		{
-			--_selectedCount;
+			newIndexes.append(createIndex(group.row, index.column(), GroupId));
 		}
 		else
 		{
-			qDebug() << "Invalid check state value:" << value;
-			return false;
+			newIndexes.append(createIndex(_entries[index.internalId()].row, index.column(), index.internalId()));
 		}
-
-		item->setValue(Qt::CheckStateRole, value);
-		emit dataChanged(index, index);
-		return true;
 	}
 
-	return false;
+	changePersistentIndexList(oldIndexes, newIndexes);
+	emit layoutChanged();
 }
 
-QVariant ResultModel::headerData(int section, Qt::Orientation orientation, int role) const
+void ResultModel::clear()
 {
-	if (orientation != Qt::Horizontal || role != Qt::DisplayRole)
+	beginResetModel();
+	// The indexes refer to the arena, so they go first
+	_groupIds.clear();
+	_entryIds.clear();
+	_groupOrder.clear();
+	_fetchedCount = 0;
+	_groups.clear();
+	_entries.clear();
+	_strings.clear();
+	_totalCount = 0;
+	_selectedCount = 0;
+	endResetModel();
+}
+
+void ResultModel::addPaths(const DuplicateList& duplicates)
+{
+	// Group the batch, so that each group gets a single insertion
+	QStringList groupOrder;
+	QHash<QString, DuplicateList> groups;
+
+	for (const Duplicate& duplicate : duplicates)
 	{
-		return QVariant();
+		const QString group = duplicate.hardlink ?
+			QString("Links to inode %1").arg(duplicate.hash) :
+			duplicate.hash;
+
+		auto it = groups.find(group);
+
+		if (it == groups.end())
+		{
+			groupOrder.append(group);
+			it = groups.insert(group, {});
+		}
+
+		it->append(duplicate);
 	}
 
-	switch (section)
+	QStringList newGroups;
+
+	for (const QString& group : groupOrder)
 	{
-		case 0:
-			return "Hash";
-		case 1:
-			return "Path";
+		const auto existing = _groupIds.constFind(group);
+
+		if (existing == _groupIds.cend())
+		{
+			newGroups.append(group);
+			continue;
+		}
+
+		const quint32 groupId = existing.value();
+		const DuplicateList& paths = groups[group];
+		const int firstRow = _groups[groupId].entries.size();
+
+		// The view asks for the rows of a group only after fetching it
+		if (!isFetched(_groups[groupId]))
+		{
+			for (const Duplicate& duplicate : paths)
+			{
+				appendPath(groupId, duplicate);
+			}
+
+			continue;
+		}
+
+		const int groupRow = _groups[groupId].row;
+		beginInsertRows(createIndex(groupRow, 0, GroupId), firstRow, firstRow + paths.size() - 1);
+
+		for (const Duplicate& duplicate : paths)
+		{
+			appendPath(groupId, duplicate);
+		}
+
+		endInsertRows();
+
+		// The count and the reclaimable bytes of the group grew with it
+		emit dataChanged(createIndex(groupRow, CountColumn, GroupId), createIndex(groupRow, ReclaimableColumn, GroupId));
 	}
 
-	return QVariant();
-}
+	if (newGroups.isEmpty())
+	{
+		return;
+	}
 
-Qt::ItemFlags ResultModel::flags(const QModelIndex& index) const
-{
-	if (index.column() != 1)
+	// New groups wait for fetchMore(), unless the view has all the previous ones.
+	// Then the first batch of them is shown right away, together with their paths
+	const bool fetchedAll = _fetchedCount == _groupOrder.size();
+
+	for (const QString& group : newGroups)
 	{
-		return Qt::ItemIsEnabled;
+		const DuplicateList& paths = groups[group];
+		const quint32 groupId = quint32(_groups.size());
+		const QStringView hash = _strings.store(group);
+
+		_groups.push_back({ hash, {}, paths.first().size, 0, int(_groupOrder.size()), paths.first().hardlink });
+		_groupOrder.append(groupId);
+		_groupIds.insert(hash, groupId);
+
+		for (const Duplicate& duplicate : paths)
+		{
+			appendPath(groupId, duplicate);
+		}
 	}
 
-	return Qt::ItemIsEnabled | Qt::ItemIsUserCheckable;
+	if (fetchedAll)
+	{
+		fetchMore(QModelIndex());
+	}
 }
 
-void ResultModel::clear()
+void ResultModel::appendPath(quint32 groupId, const Duplicate& duplicate)
 {
-	beginResetModel();
-	delete _root;
-	_root = new Node(nullptr, { { Qt::DisplayRole, "root" } });
-	_totalCount = 0;
-	_selectedCount = 0;
-	endResetModel();
-}
+	Group& group = _groups[groupId];
+	const quint32 entryId = quint32(_entries.size());
 
-void ResultModel::addPath(const QString& hash, const QString& filePath)
-{
-	const auto hashEquals = [&](const Node* node)
-	{
-		return node->displayString() == hash;
-	};
+	// The path of a hard link group is usually already stored for a hash group
+	const auto existing = _entryIds.constFind(duplicate.filePath);
+	const QStringView path = existing != _entryIds.cend() ?
+		_entries[existing.value()].path :
+		_strings.store(duplicate.filePath);
+
+	Entry entry;
+	entry.path = path;
+	entry.group = groupId;
+	entry.row = group.entries.size();
+	entry.checked = false;
+	entry.checkable = !duplicate.hardlink;
+	entry.shared = false;
+	_entries.push_back(entry);
 
-	Node* hashNode = _root->findChild(hashEquals);
+	group.entries.append(entryId);
+	_entryIds.insert(path, entryId);
 
-	if (!hashNode)
+	if (entry.checkable)
 	{
-		int newHashRow = _root->childCount();
-		beginInsertRows(QModelIndex(), newHashRow, newHashRow);
-		hashNode = _root->appendChild({ { Qt::DisplayRole, hash } });
-		hashNode->appendChild({ { Qt::DisplayRole, filePath }, { Qt::CheckStateRole, Qt::Unchecked } });
 		++_totalCount;
-		endInsertRows();
 	}
-	else
+}
+
+QStringList ResultModel::paths() const
+{
+	QStringList results;
+
+	// Hard link groups mostly repeat paths of the hash groups
+	for (QStringView filePath : _entryIds.uniqueKeys())
 	{
-		QModelIndex hashIndex = createIndex(hashNode->parentRow(), 0, hashNode);
-		int newPathRow = hashNode->childCount();
-		beginInsertRows(hashIndex, newPathRow, newPathRow);
-		hashNode->appendChild({ { Qt::DisplayRole, filePath }, { Qt::CheckStateRole, Qt::Unchecked } });
-		++_totalCount;
-		endInsertRows();
+		results.append(filePath.toString());
 	}
+
+	return results;
 }
 
 QStringList ResultModel::selectedPaths() const
 {
 	QStringList results;
 
-	const auto isChecked = [&](const Node* node)
+	for (quint32 groupId : _groupOrder)
 	{
-		return node->isChecked();
-	};
+		for (quint32 entryId : _groups[groupId].entries)
+		{
+			const Entry& entry = _entries[entryId];
+
+			if (entry.checked)
+			{
+				results.append(entry.path.toString());
+			}
+		}
+	}
+
+	return results;
+}
+
+QList<QStringList> ResultModel::selectedGroups() const
+{
+	QList<QStringList> results;
 
-	for (const Node* node : _root->findChildren(isChecked))
+	for (quint32 groupId : _groupOrder)
 	{
-		results.append(node->displayString());
+		const Group& group = _groups[groupId];
+
+		if (group.hardlink)
+		{
+			continue;
+		}
+
+		QString source;
+		QStringList targets;
+
+		for (quint32 entryId : group.entries)
+		{
+			const Entry& entry = _entries[entryId];
+
+			if (entry.checked)
+			{
+				targets.append(entry.path.toString());
+			}
+			else if (source.isEmpty())
+			{
+				source = entry.path.toString();
+			}
+		}
+
+		if (targets.isEmpty())
+		{
+			continue;
+		}
+
+		// Everything selected, one of them has to stay as it is
+		if (source.isEmpty())
+		{
+			source = targets.takeFirst();
+		}
+
+		targets.prepend(source);
+		results.append(targets);
 	}
 
 	return results;
@@ -336,72 +542,358 @@ int ResultModel::selectedCount() const
 	return _selectedCount;
 }
 
+void ResultModel::prune(const std::function<bool(const QString&)>& predicate)
+{
+	QStringList filePaths;
+
+	for (quint32 groupId : _groupOrder)
+	{
+		for (quint32 entryId : _groups[groupId].entries)
+		{
+			const QString filePath = _entries[entryId].path.toString();
 
-void ResultModel::prune(const std::function<bool(const Node*)>& predicate)
+			if (predicate(filePath))
+			{
+				filePaths.append(filePath);
+			}
+		}
+	}
+
+	removePaths(filePaths);
+}
+
+void ResultModel::removePath(const QString& filePath)
 {
-	int i = _root->childCount();
+	removePaths({ filePath });
+}
 
-	beginResetModel();
+void ResultModel::removePaths(const QStringList& filePaths)
+{
+	// Collect the affected entries per group through the path index
+	QHash<quint32, QVector<quint32>> removals;
 
-	while (i--)
+	for (const QString& filePath : filePaths)
 	{
-		Node* hashNode = _root->childAt(i);
+		for (auto it = _entryIds.constFind(filePath); it != _entryIds.cend() && it.key() == filePath; ++it)
+		{
+			removals[_entries[it.value()].group].append(it.value());
+		}
+	}
+
+	QVector<int> collapsedRows;
+
+	for (auto it = removals.begin(); it != removals.end(); ++it)
+	{
+		Group& group = _groups[it.key()];
+		QVector<quint32>& entryIds = it.value();
 
-		for (const Node* pathNode : hashNode->takeChildren(predicate))
+		const auto byRowDescending = [&](quint32 lhs, quint32 rhs)
 		{
-			if (pathNode->isChecked())
+			return _entries[lhs].row > _entries[rhs].row;
+		};
+
+		std::sort(entryIds.begin(), entryIds.end(), byRowDescending);
+		entryIds.erase(std::unique(entryIds.begin(), entryIds.end()), entryIds.end());
+
+		// If a hash has one of fewer instances remove it from the model
+		// The point of the application is to find duplicates
+		if (group.entries.size() - entryIds.size() < 2)
+		{
+			collapsedRows.append(group.row);
+			continue;
+		}
+
+		if (!isFetched(group))
+		{
+			for (quint32 entryId : entryIds)
 			{
-				--_selectedCount;
+				forgetEntry(entryId);
+				group.entries.remove(_entries[entryId].row);
 			}
 
-			--_totalCount;
+			for (int row = 0; row < group.entries.size(); ++row)
+			{
+				_entries[group.entries[row]].row = row;
+			}
 
-			delete pathNode;
+			continue;
 		}
 
-		// If a hash has one of fewer instances remove it from the model
-		// The point of the application is to find duplicates
-		if (hashNode->childCount() < 2)
+		const QModelIndex groupIndex = createIndex(group.row, 0, GroupId);
+
+		// Contiguous rows are removed together, the last ones first so that the rest stay valid
+		for (int i = 0; i < entryIds.size();)
 		{
-			// Check if the hash node has a lone child
-			if (hashNode->childCount() == 1)
+			const int last = _entries[entryIds[i]].row;
+			int first = last;
+			int next = i + 1;
+
+			while (next < entryIds.size() && _entries[entryIds[next]].row == first - 1)
+			{
+				--first;
+				++next;
+			}
+
+			beginRemoveRows(groupIndex, first, last);
+
+			for (; i < next; ++i)
 			{
-				const Node* lone = hashNode->childAt(0);
+				forgetEntry(entryIds[i]);
+			}
 
-				if (lone->isChecked())
-				{
-					--_selectedCount;
-				}
+			group.entries.remove(first, last - first + 1);
 
-				--_totalCount;
+			for (int row = first; row < group.entries.size(); ++row)
+			{
+				_entries[group.entries[row]].row = row;
 			}
 
-			// Delete the hash node itself
-			// Which will also delete any remaining children. see Node dtor
-			delete _root->takeChild(i);
+			endRemoveRows();
 		}
 	}
 
-	endResetModel();
+	removeGroups(collapsedRows);
 }
 
-void ResultModel::removePath(const QString& filePath)
+void ResultModel::markShared(const QStringList& filePaths)
 {
-	const auto pathEquals = [&](const Node* node)
+	for (const QString& filePath : filePaths)
 	{
-		return node->displayString() == filePath;
-	};
+		for (auto it = _entryIds.constFind(filePath); it != _entryIds.cend() && it.key() == filePath; ++it)
+		{
+			Entry& entry = _entries[it.value()];
+			Group& group = _groups[entry.group];
 
-	prune(pathEquals);
+			// Hard link groups are left as they are, their entries can not be checked anyway
+			if (group.hardlink || entry.shared)
+			{
+				continue;
+			}
+
+			_selectedCount -= entry.checked ? 1 : 0;
+			_totalCount -= entry.checkable ? 1 : 0;
+			entry.checked = false;
+			entry.checkable = false;
+			entry.shared = true;
+			++group.sharedCount;
+
+			if (!isFetched(group))
+			{
+				continue;
+			}
+
+			const QModelIndex groupIndex = createIndex(group.row, 0, GroupId);
+			emit dataChanged(index(entry.row, 0, groupIndex), index(entry.row, ColumnCount - 1, groupIndex));
+			emit dataChanged(groupIndex.siblingAtColumn(ReclaimableColumn), groupIndex.siblingAtColumn(ReclaimableColumn));
+		}
+	}
+}
+
+bool ResultModel::isGroup(const QModelIndex& index) const
+{
+	return index.internalId() == GroupId;
 }
 
-void ResultModel::removeInexistentPaths()
+bool ResultModel::isFetched(const Group& group) const
 {
-	const auto missing = [](const Node* node)
+	return group.row < _fetchedCount;
+}
+
+qint64 ResultModel::sortKey(const Group& group, int column) const
+{
+	switch (column)
+	{
+		case SizeColumn:
+			return group.size;
+		case CountColumn:
+			return group.entries.size();
+		case ReclaimableColumn:
+			return reclaimable(group);
+	}
+
+	return 0;
+}
+
+void ResultModel::sortEntries(const std::function<bool(quint32, quint32)>& lessThan)
+{
+	for (quint32 groupId : _groupOrder)
+	{
+		Group& group = _groups[groupId];
+		std::stable_sort(group.entries.begin(), group.entries.end(), lessThan);
+
+		for (int row = 0; row < group.entries.size(); ++row)
+		{
+			_entries[group.entries[row]].row = row;
+		}
+	}
+}
+
+qint64 ResultModel::reclaimable(const Group& group)
+{
+	// Hard links are already deduplicated, deleting one does not free any space.
+	// Neither does deleting a file which shares its storage with another one
+	const qsizetype copies = group.entries.size() - group.sharedCount;
+	return group.hardlink || copies < 2 ? 0 : group.size * (copies - 1);
+}
+
+const ResultModel::Group& ResultModel::groupAt(const QModelIndex& index) const
+{
+	return _groups[_groupOrder[index.row()]];
+}
+
+void ResultModel::removeGroups(QVector<int> rows)
+{
+	if (rows.isEmpty())
+	{
+		return;
+	}
+
+	std::sort(rows.begin(), rows.end(), std::greater<int>());
+
+	int ranges = 1;
+
+	for (int i = 1; i < rows.size(); ++i)
+	{
+		ranges += rows[i] == rows[i - 1] - 1 ? 0 : 1;
+	}
+
+	if (ranges > RemovalRangeLimit)
+	{
+		// Unlike a reset, the view keeps its scroll position, selection and expansion
+		emit layoutAboutToBeChanged();
+
+		// The persistent indexes are remapped through the group ids
+		const QModelIndexList oldIndexes = persistentIndexList();
+		QVector<quint32> oldGroupIds;
+
+		for (const QModelIndex& index : oldIndexes)
+		{
+			oldGroupIds.append(isGroup(index) ? _groupOrder[index.row()] : _entries[index.internalId()].group);
+		}
+
+		for (int row : rows)
+		{
+			forgetGroup(_groupOrder[row]);
+			_fetchedCount -= row < _fetchedCount ? 1 : 0;
+		}
+
+		// Only the forgotten groups are left without entries
+		const auto forgotten = [&](quint32 groupId)
+		{
+			return _groups[groupId].entries.isEmpty();
+		};
+
+		_groupOrder.erase(std::remove_if(_groupOrder.begin(), _groupOrder.end(), forgotten), _groupOrder.end());
+
+		for (int row = 0; row < _groupOrder.size(); ++row)
+		{
+			_groups[_groupOrder[row]].row = row;
+		}
+
+		QModelIndexList newIndexes;
+
+		for (int i = 0; i < oldIndexes.size(); ++i)
+		{
+			const QModelIndex& index = oldIndexes[i];
+			const Group& group = _groups[oldGroupIds[i]];
+
+			// The rows of an entry do not change, only those of the groups
+			if (group.entries.isEmpty())
+			{
+				newIndexes.append(QModelIndex());
+			}
+			else if (isGroup(index))
+			{
+				newIndexes.append(createIndex(group.row, index.column(), GroupId));
+			}
+			else
+			{
+				newIndexes.append(index);
+			}
+		}
+
+		changePersistentIndexList(oldIndexes, newIndexes);
+		emit layoutChanged();
+		return;
+	}
+
+	for (int i = 0; i < rows.size();)
+	{
+		const int last = rows[i];
+		int first = last;
+
+		while (++i < rows.size() && rows[i] == first - 1)
+		{
+			--first;
+		}
+
+		// The view is told only about the rows it has fetched
+		const int fetchedLast = std::min(last, _fetchedCount - 1);
+
+		if (fetchedLast < last)
+		{
+			eraseGroups(std::max(first, _fetchedCount), last);
+		}
+
+		if (first <= fetchedLast)
+		{
+			beginRemoveRows(QModelIndex(), first, fetchedLast);
+			eraseGroups(first, fetchedLast);
+			_fetchedCount -= fetchedLast - first + 1;
+			endRemoveRows();
+		}
+	}
+}
+
+void ResultModel::eraseGroups(int first, int last)
+{
+	for (int row = first; row <= last; ++row)
+	{
+		forgetGroup(_groupOrder[row]);
+	}
+
+	_groupOrder.remove(first, last - first + 1);
+
+	for (int row = first; row < _groupOrder.size(); ++row)
+	{
+		_groups[_groupOrder[row]].row = row;
+	}
+}
+
+void ResultModel::forgetGroup(quint32 groupId)
+{
+	Group& group = _groups[groupId];
+
+	for (quint32 entryId : group.entries)
 	{
-		const QString filePath = node->displayString();
-		return !QFile::exists(filePath);
-	};
+		forgetEntry(entryId);
+	}
+
+	// The storage of removed groups and entries is reclaimed by clear()
+	_groupIds.remove(group.hash);
+	group.entries.clear();
+}
+
+void ResultModel::forgetEntry(quint32 entryId)
+{
+	Entry& entry = _entries[entryId];
+
+	if (entry.checked)
+	{
+		--_selectedCount;
+	}
+
+	if (entry.checkable)
+	{
+		--_totalCount;
+	}
+
+	if (entry.shared)
+	{
+		--_groups[entry.group].sharedCount;
+	}
 
-	prune(missing);
+	entry.checked = false;
+	entry.shared = false;
+	_entryIds.remove(entry.path, entryId);
 }
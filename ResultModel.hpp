@@ -1,15 +1,32 @@
 #pragma once
 
 #include <QAbstractItemModel>
+#include <QHash>
+#include <QMultiHash>
+#include <QStringList>
+#include <QVector>
 #include <functional>
+#include <vector>
 
-class Node;
+#include "Duplicate.hpp"
+#include "StringArena.hpp"
 
 class ResultModel : public QAbstractItemModel
 {
 	Q_OBJECT
 
 public:
+	enum Column : int
+	{
+		HashColumn,
+		PathColumn,
+		SizeColumn,
+		CountColumn,
+		// The bytes freed by keeping only one file of the group
+		ReclaimableColumn,
+		ColumnCount
+	};
+
 	explicit ResultModel(QObject* parent = nullptr);
 	~ResultModel();
 
@@ -24,20 +41,83 @@ public:
 
 	QVariant headerData(int section, Qt::Orientation orientation, int role = Qt::DisplayRole) const override;
 
+	// The groups are handed to the view a batch at a time, as it scrolls towards the end
+	bool canFetchMore(const QModelIndex& parentIndex) const override;
+	void fetchMore(const QModelIndex& parentIndex) override;
+
 	Qt::ItemFlags flags(const QModelIndex& index) const override;
 
+	// Sorts the groups, or by the path column the entries of each group.
+	// An invalid column restores the order in which they were found, the ids grow in that order
+	void sort(int column, Qt::SortOrder order = Qt::AscendingOrder) override;
+
 	void clear();
-	void addPath(const QString& hash, const QString& filePath);
+	void addPaths(const DuplicateList& duplicates);
+	QStringList paths() const;
 	QStringList selectedPaths() const;
+	// Per group with a selection, the first unselected path followed by the selected ones
+	QList<QStringList> selectedGroups() const;
 	int totalCount() const;
 	int selectedCount() const;
-	void prune(const std::function<bool(const Node*)>& predicate);
+	void prune(const std::function<bool(const QString&)>& predicate);
 	void removePath(const QString& filePath);
-	void removeInexistentPaths();
+	void removePaths(const QStringList& filePaths);
+	// The paths share their storage with another duplicate now. They are unchecked,
+	// can not be checked anymore and no longer count as reclaimable
+	void markShared(const QStringList& filePaths);
 
 private:
-	Node* _root = nullptr;
+	// Groups and entries are referred to by their position in _groups and _entries.
+	// The internal id of an entry index is the entry id, group indexes use GroupId
+	static constexpr quintptr GroupId = ~quintptr(0);
+
+	// Above this many separate group ranges a single layout change is cheaper than removing each
+	static constexpr int RemovalRangeLimit = 0x40;
+
+	// Groups per fetchMore(), a few screenfuls
+	static constexpr int FetchBatchSize = 0x400;
+
+	struct Group
+	{
+		QStringView hash;
+		QVector<quint32> entries;
+		qint64 size;
+		int sharedCount;
+		int row;
+		bool hardlink;
+	};
+
+	struct Entry
+	{
+		QStringView path;
+		quint32 group;
+		int row;
+		bool checked : 1;
+		bool checkable : 1;
+		bool shared : 1;
+	};
+
+	bool isGroup(const QModelIndex& index) const;
+	bool isFetched(const Group& group) const;
+	qint64 sortKey(const Group& group, int column) const;
+	static qint64 reclaimable(const Group& group);
+	void sortEntries(const std::function<bool(quint32, quint32)>& lessThan);
+	const Group& groupAt(const QModelIndex& index) const;
+	void appendPath(quint32 groupId, const Duplicate& duplicate);
+	void forgetEntry(quint32 entryId);
+	void forgetGroup(quint32 groupId);
+	void removeGroups(QVector<int> rows);
+	void eraseGroups(int first, int last);
+
+	StringArena _strings;
+	std::vector<Group> _groups;
+	std::vector<Entry> _entries;
+	QVector<quint32> _groupOrder;
+	// The groups in _groupOrder before this row are known to the view
+	int _fetchedCount = 0;
+	QHash<QStringView, quint32> _groupIds;
+	// A path can be both in a hash group and a hard link group
+	QMultiHash<QStringView, quint32> _entryIds;
 	int _totalCount = 0;
 	int _selectedCount = 0;
 };
-
@@ -0,0 +1,79 @@
+#include "ScanProgress.hpp"
+
+#include <chrono>
+
+namespace
+{
+	qint64 monotonicMilliseconds()
+	{
+		const auto sinceEpoch = std::chrono::steady_clock::now().time_since_epoch();
+		return std::chrono::duration_cast<std::chrono::milliseconds>(sinceEpoch).count();
+	}
+}
+
+qint64 ScanProgress::Snapshot::value(Counter counter) const
+{
+	return counters[counter];
+}
+
+qint64 ScanProgress::Snapshot::bytesRemaining() const
+{
+	return value(CandidateBytes) - value(ResolvedBytes);
+}
+
+qint64 ScanProgress::Snapshot::rate(Counter counter, const Snapshot& earlier) const
+{
+	const qint64 interval = elapsed - earlier.elapsed;
+	return interval > 0 ? (value(counter) - earlier.value(counter)) * 1000 / interval : 0;
+}
+
+qint64 ScanProgress::Snapshot::estimatedTimeLeft() const
+{
+	const qint64 resolved = value(ResolvedBytes);
+
+	if (resolved <= 0 || elapsed <= 0)
+	{
+		return -1;
+	}
+
+	// In floating point, bytes times milliseconds easily overflows
+	return static_cast<qint64>(double(bytesRemaining()) * elapsed / resolved);
+}
+
+void ScanProgress::reset()
+{
+	for (std::atomic<qint64>& counter : _counters)
+	{
+		counter = 0;
+	}
+
+	setCurrentPath({});
+	_startTime = monotonicMilliseconds();
+}
+
+void ScanProgress::add(Counter counter, qint64 value)
+{
+	_counters[counter].fetch_add(value, std::memory_order_relaxed);
+}
+
+void ScanProgress::setCurrentPath(const QString& path)
+{
+	QMutexLocker lock(&_mutex);
+	_currentPath = path;
+}
+
+ScanProgress::Snapshot ScanProgress::snapshot() const
+{
+	Snapshot snapshot;
+	const qint64 startTime = _startTime;
+	snapshot.elapsed = startTime >= 0 ? monotonicMilliseconds() - startTime : 0;
+
+	for (int i = 0; i < CounterCount; ++i)
+	{
+		snapshot.counters[i] = _counters[i].load(std::memory_order_relaxed);
+	}
+
+	QMutexLocker lock(&_mutex);
+	snapshot.currentPath = _currentPath;
+	return snapshot;
+}
@@ -0,0 +1,55 @@
+#pragma once
+
+#include <QMutex>
+#include <QString>
+#include <array>
+#include <atomic>
+
+// Counters updated by the scan threads and sampled by whoever displays the progress,
+// so that progress reporting costs nothing per block and the display rate is up to the reader
+class ScanProgress
+{
+public:
+	enum Counter
+	{
+		FilesFound,
+		Candidates,
+		CandidateBytes,
+		PartialHashes,
+		FullHashes,
+		ResolvedFiles,
+		ResolvedBytes,
+		BytesRead,
+		Duplicates,
+		Hardlinks,
+		CounterCount
+	};
+
+	struct Snapshot
+	{
+		qint64 elapsed = 0; // Milliseconds since the scan started
+		std::array<qint64, CounterCount> counters = {};
+		QString currentPath;
+
+		qint64 value(Counter counter) const;
+		qint64 bytesRemaining() const;
+
+		// Per second, averaged since the given earlier snapshot
+		qint64 rate(Counter counter, const Snapshot& earlier) const;
+
+		// Milliseconds, extrapolated from the average rate so far. Negative if unknown.
+		qint64 estimatedTimeLeft() const;
+	};
+
+	void reset();
+	void add(Counter counter, qint64 value = 1);
+	void setCurrentPath(const QString& path);
+
+	Snapshot snapshot() const;
+
+private:
+	std::atomic<qint64> _startTime { -1 };
+	std::array<std::atomic<qint64>, CounterCount> _counters = {};
+	mutable QMutex _mutex;
+	QString _currentPath;
+};
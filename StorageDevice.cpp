@@ -0,0 +1,32 @@
+#include "StorageDevice.hpp"
+
+#include <QDebug>
+#include <QFile>
+
+#ifdef Q_OS_LINUX
+#include <sys/sysmacros.h>
+#endif
+
+bool StorageDevice::isRotational(quint64 device)
+{
+#ifdef Q_OS_LINUX
+	const QString path = QString("/sys/dev/block/%1:%2").arg(major(device)).arg(minor(device));
+
+	// A partition has no queue of its own, its parent disk does
+	for (const QString& rotational : { path + "/queue/rotational", path + "/../queue/rotational" })
+	{
+		QFile file(rotational);
+
+		if (file.open(QIODevice::ReadOnly))
+		{
+			return file.readAll().trimmed() == "1";
+		}
+	}
+
+	qDebug() << "Unknown block device" << path;
+#else
+	Q_UNUSED(device);
+#endif
+
+	return false;
+}
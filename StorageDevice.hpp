@@ -0,0 +1,12 @@
+#pragma once
+
+#include <QtGlobal>
+
+// What is known about the block device behind a device id of FileIdentity
+class StorageDevice
+{
+public:
+	// A spinning disk seeks between concurrent streams, so it is read by one thread at a time.
+	// Unknown devices are assumed to be solid state
+	static bool isRotational(quint64 device);
+};
@@ -0,0 +1,41 @@
+#include "StringArena.hpp"
+
+#include <algorithm>
+
+QStringView StringArena::store(QStringView string)
+{
+	const qsizetype length = string.size();
+
+	if (length == 0)
+	{
+		return QStringView();
+	}
+
+	if (length > ChunkSize - _used)
+	{
+		// Oversized strings get a chunk of their own, inserted before the current one
+		// so that the remaining space of the current chunk is not wasted
+		if (length > ChunkSize / 2)
+		{
+			std::unique_ptr<QChar[]> chunk(new QChar[length]);
+			std::copy(string.begin(), string.end(), chunk.get());
+			const QStringView result(chunk.get(), length);
+			_chunks.insert(_chunks.end() - (_chunks.empty() ? 0 : 1), std::move(chunk));
+			return result;
+		}
+
+		_chunks.emplace_back(new QChar[ChunkSize]);
+		_used = 0;
+	}
+
+	QChar* destination = _chunks.back().get() + _used;
+	std::copy(string.begin(), string.end(), destination);
+	_used += length;
+	return QStringView(destination, length);
+}
+
+void StringArena::clear()
+{
+	_chunks.clear();
+	_used = ChunkSize;
+}
@@ -0,0 +1,21 @@
+#pragma once
+
+#include <QString>
+#include <QStringView>
+#include <memory>
+#include <vector>
+
+// Append only string storage. Strings are copied once into large chunks which never move,
+// so the returned views stay valid until clear() and cost no allocation of their own
+class StringArena
+{
+public:
+	QStringView store(QStringView string);
+	void clear();
+
+private:
+	static constexpr qsizetype ChunkSize = 0x40000;
+
+	std::vector<std::unique_ptr<QChar[]>> _chunks;
+	qsizetype _used = ChunkSize;
+};
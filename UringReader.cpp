@@ -0,0 +1,418 @@
+#include "UringReader.hpp"
+
+#include <QDebug>
+#include <QFile>
+
+#if defined(Q_OS_LINUX) && __has_include(<linux/io_uring.h>)
+#define DUFF_HAS_IO_URING
+#include <linux/io_uring.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#endif
+
+#ifdef DUFF_HAS_IO_URING
+
+// The shared memory of the kernel's submission and completion queues
+struct UringReader::Ring
+{
+	~Ring()
+	{
+		if (entries != MAP_FAILED)
+		{
+			munmap(entries, entriesSize);
+		}
+
+		if (completionRing != MAP_FAILED && completionRing != submissionRing)
+		{
+			munmap(completionRing, completionRingSize);
+		}
+
+		if (submissionRing != MAP_FAILED)
+		{
+			munmap(submissionRing, submissionRingSize);
+		}
+
+		if (descriptor >= 0)
+		{
+			close(descriptor);
+		}
+	}
+
+	int descriptor = -1;
+
+	void* submissionRing = MAP_FAILED;
+	size_t submissionRingSize = 0;
+	void* completionRing = MAP_FAILED;
+	size_t completionRingSize = 0;
+	void* entries = MAP_FAILED;
+	size_t entriesSize = 0;
+
+	unsigned* submissionTail = nullptr;
+	unsigned* submissionMask = nullptr;
+	unsigned* submissionArray = nullptr;
+	io_uring_sqe* submissionEntries = nullptr;
+
+	unsigned* completionHead = nullptr;
+	unsigned* completionTail = nullptr;
+	unsigned* completionMask = nullptr;
+	io_uring_cqe* completionEntries = nullptr;
+
+	unsigned unsubmitted = 0;
+};
+
+struct UringReader::Slot
+{
+	size_t job = 0;
+	qint64 offset = 0;
+	qint64 length = 0;
+	qint64 result = 0;
+	bool complete = false;
+	iovec vector = {};
+};
+
+UringReader::UringReader(unsigned queueDepth) :
+	_queueDepth(qMax(1u, queueDepth)),
+	_ring(new Ring()),
+	_slots(_queueDepth),
+	_buffers(_queueDepth * BlockSize)
+{
+	io_uring_params params = {};
+	_ring->descriptor = static_cast<int>(syscall(__NR_io_uring_setup, _queueDepth, &params));
+
+	if (_ring->descriptor < 0)
+	{
+		qDebug() << "io_uring unavailable:" << strerror(errno);
+		_ring.reset();
+		return;
+	}
+
+	_ring->submissionRingSize = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+	_ring->completionRingSize = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+
+	const bool singleMap = params.features & IORING_FEAT_SINGLE_MMAP;
+
+	if (singleMap)
+	{
+		_ring->submissionRingSize = std::max(_ring->submissionRingSize, _ring->completionRingSize);
+	}
+
+	_ring->submissionRing = mmap(nullptr, _ring->submissionRingSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, _ring->descriptor, IORING_OFF_SQ_RING);
+
+	if (_ring->submissionRing == MAP_FAILED)
+	{
+		qWarning() << "Failed to map io_uring submission ring:" << strerror(errno);
+		_ring.reset();
+		return;
+	}
+
+	_ring->completionRing = singleMap ? _ring->submissionRing :
+		mmap(nullptr, _ring->completionRingSize, PROT_READ | PROT_WRITE,
+			MAP_SHARED | MAP_POPULATE, _ring->descriptor, IORING_OFF_CQ_RING);
+
+	if (_ring->completionRing == MAP_FAILED)
+	{
+		qWarning() << "Failed to map io_uring completion ring:" << strerror(errno);
+		_ring.reset();
+		return;
+	}
+
+	_ring->entriesSize = params.sq_entries * sizeof(io_uring_sqe);
+	_ring->entries = mmap(nullptr, _ring->entriesSize, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, _ring->descriptor, IORING_OFF_SQES);
+
+	if (_ring->entries == MAP_FAILED)
+	{
+		qWarning() << "Failed to map io_uring entries:" << strerror(errno);
+		_ring.reset();
+		return;
+	}
+
+	char* submission = static_cast<char*>(_ring->submissionRing);
+	_ring->submissionTail = reinterpret_cast<unsigned*>(submission + params.sq_off.tail);
+	_ring->submissionMask = reinterpret_cast<unsigned*>(submission + params.sq_off.ring_mask);
+	_ring->submissionArray = reinterpret_cast<unsigned*>(submission + params.sq_off.array);
+	_ring->submissionEntries = static_cast<io_uring_sqe*>(_ring->entries);
+
+	char* completion = static_cast<char*>(_ring->completionRing);
+	_ring->completionHead = reinterpret_cast<unsigned*>(completion + params.cq_off.head);
+	_ring->completionTail = reinterpret_cast<unsigned*>(completion + params.cq_off.tail);
+	_ring->completionMask = reinterpret_cast<unsigned*>(completion + params.cq_off.ring_mask);
+	_ring->completionEntries = reinterpret_cast<io_uring_cqe*>(completion + params.cq_off.cqes);
+
+	for (unsigned i = 0; i < _queueDepth; ++i)
+	{
+		_slots[i].vector.iov_base = _buffers.data() + i * BlockSize;
+	}
+}
+
+UringReader::~UringReader() = default;
+
+bool UringReader::isValid() const
+{
+	return _ring != nullptr;
+}
+
+void UringReader::submit(int slotIndex, int descriptor, qint64 offset, qint64 length)
+{
+	Slot& slot = _slots[slotIndex];
+	slot.offset = offset;
+	slot.length = length;
+	slot.complete = false;
+	slot.vector.iov_len = static_cast<size_t>(length);
+
+	// Only this thread produces submissions, the kernel only reads the tail
+	const unsigned tail = *_ring->submissionTail;
+	const unsigned index = tail & *_ring->submissionMask;
+
+	io_uring_sqe* entry = &_ring->submissionEntries[index];
+	std::memset(entry, 0, sizeof(io_uring_sqe));
+	entry->opcode = IORING_OP_READV;
+	entry->fd = descriptor;
+	entry->off = static_cast<__u64>(offset);
+	entry->addr = reinterpret_cast<__u64>(&slot.vector);
+	entry->len = 1;
+	entry->user_data = static_cast<__u64>(slotIndex);
+
+	_ring->submissionArray[index] = index;
+	__atomic_store_n(_ring->submissionTail, tail + 1, __ATOMIC_RELEASE);
+	++_ring->unsubmitted;
+}
+
+bool UringReader::enter(unsigned minComplete)
+{
+	while (true)
+	{
+		const long result = syscall(__NR_io_uring_enter, _ring->descriptor,
+			_ring->unsubmitted, minComplete, IORING_ENTER_GETEVENTS, nullptr, 0);
+
+		if (result >= 0)
+		{
+			_ring->unsubmitted -= static_cast<unsigned>(result);
+			return true;
+		}
+
+		if (errno != EINTR && errno != EAGAIN && errno != EBUSY)
+		{
+			qWarning() << "io_uring_enter failed:" << strerror(errno);
+			return false;
+		}
+	}
+}
+
+void UringReader::reap()
+{
+	unsigned head = *_ring->completionHead;
+	const unsigned tail = __atomic_load_n(_ring->completionTail, __ATOMIC_ACQUIRE);
+
+	for (; head != tail; ++head)
+	{
+		const io_uring_cqe& entry = _ring->completionEntries[head & *_ring->completionMask];
+		Slot& slot = _slots[entry.user_data];
+		slot.result = entry.res;
+		slot.complete = true;
+	}
+
+	__atomic_store_n(_ring->completionHead, head, __ATOMIC_RELEASE);
+}
+
+void UringReader::read(std::vector<Job>& jobs)
+{
+	struct File
+	{
+		int descriptor = -1;
+		qint64 submitted = 0;
+		std::deque<int> slots; // In file order
+	};
+
+	std::vector<File> files(jobs.size());
+
+	for (size_t i = 0; i < jobs.size(); ++i)
+	{
+		const QByteArray nativePath = QFile::encodeName(jobs[i].filePath);
+		files[i].descriptor = open(nativePath.constData(), O_RDONLY | O_CLOEXEC);
+
+		struct stat status = {};
+
+		if (files[i].descriptor < 0 || fstat(files[i].descriptor, &status) != 0)
+		{
+			jobs[i].status = Status::OpenFailed;
+			continue;
+		}
+
+		jobs[i].size = status.st_size;
+
+		if (jobs[i].size <= 0)
+		{
+			jobs[i].status = Status::Success;
+		}
+	}
+
+	std::vector<int> freeSlots;
+
+	for (int i = static_cast<int>(_queueDepth) - 1; i >= 0; --i)
+	{
+		freeSlots.push_back(i);
+	}
+
+	size_t cursor = 0;
+
+	while (true)
+	{
+		// Hand out the free slots round robin, so every file progresses
+		for (size_t idle = 0; !freeSlots.empty() && idle < jobs.size(); cursor = (cursor + 1) % jobs.size())
+		{
+			Job& job = jobs[cursor];
+			File& file = files[cursor];
+
+			if (job.status != Status::Pending || file.submitted >= job.size)
+			{
+				++idle;
+				continue;
+			}
+
+			const int slotIndex = freeSlots.back();
+			freeSlots.pop_back();
+
+			_slots[slotIndex].job = cursor;
+			const qint64 length = qMin(BlockSize, job.size - file.submitted);
+			submit(slotIndex, file.descriptor, file.submitted, length);
+			file.submitted += length;
+			file.slots.push_back(slotIndex);
+			idle = 0;
+		}
+
+		if (freeSlots.size() == _queueDepth)
+		{
+			break;
+		}
+
+		if (!enter(1))
+		{
+			// Closing the ring cancels whatever is still in flight
+			for (Job& job : jobs)
+			{
+				if (job.status == Status::Pending)
+				{
+					job.status = Status::ReadFailed;
+				}
+			}
+
+			_ring.reset();
+			break;
+		}
+
+		reap();
+
+		for (size_t i = 0; i < jobs.size(); ++i)
+		{
+			Job& job = jobs[i];
+			File& file = files[i];
+
+			while (!file.slots.empty() && _slots[file.slots.front()].complete)
+			{
+				const int slotIndex = file.slots.front();
+				Slot& slot = _slots[slotIndex];
+
+				if (job.status == Status::Pending)
+				{
+					if (slot.result == -EINTR || slot.result == -EAGAIN)
+					{
+						submit(slotIndex, file.descriptor, slot.offset, slot.length);
+						break;
+					}
+
+					// Zero means the file has shrunk since it was opened
+					if (slot.result <= 0)
+					{
+						job.status = Status::ReadFailed;
+					}
+					else if (!job.consumer(static_cast<const char*>(slot.vector.iov_base), slot.result))
+					{
+						job.status = Status::Stopped;
+					}
+					else if (slot.result < slot.length)
+					{
+						// A short read, the rest goes to the beginning of the same buffer
+						submit(slotIndex, file.descriptor, slot.offset + slot.result, slot.length - slot.result);
+						break;
+					}
+				}
+
+				file.slots.pop_front();
+				freeSlots.push_back(slotIndex);
+			}
+
+			if (job.status == Status::Pending && file.slots.empty() && file.submitted >= job.size)
+			{
+				job.status = Status::Success;
+			}
+		}
+	}
+
+	for (const File& file : files)
+	{
+		if (file.descriptor >= 0)
+		{
+			close(file.descriptor);
+		}
+	}
+}
+
+#else
+
+struct UringReader::Ring
+{
+};
+
+struct UringReader::Slot
+{
+};
+
+UringReader::UringReader(unsigned queueDepth) :
+	_queueDepth(queueDepth)
+{
+}
+
+UringReader::~UringReader() = default;
+
+bool UringReader::isValid() const
+{
+	return false;
+}
+
+void UringReader::submit(int, int, qint64, qint64)
+{
+}
+
+bool UringReader::enter(unsigned)
+{
+	return false;
+}
+
+void UringReader::reap()
+{
+}
+
+void UringReader::read(std::vector<Job>& jobs)
+{
+	for (Job& job : jobs)
+	{
+		job.status = Status::ReadFailed;
+	}
+}
+
+#endif
+
+unsigned UringReader::queueDepth() const
+{
+	return _queueDepth;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QString>
+#include <functional>
+#include <memory>
+#include <vector>
+
+// Reads several files at once through io_uring, keeping up to queue depth
+// reads in flight across them. The blocks of each file are handed to its
+// consumer in file order. Not valid where io_uring is unavailable, e.g.
+// on other platforms, on old kernels or when blocked by a seccomp policy.
+class UringReader
+{
+public:
+	enum class Status : char
+	{
+		Pending,
+		Success,
+		OpenFailed,
+		ReadFailed,
+		Stopped
+	};
+
+	// Receives the data block by block. Returning false stops reading the file.
+	using Consumer = std::function<bool(const char* data, qint64 length)>;
+
+	struct Job
+	{
+		QString filePath;
+		Consumer consumer;
+		Status status = Status::Pending;
+		qint64 size = 0;
+	};
+
+	explicit UringReader(unsigned queueDepth);
+	~UringReader();
+
+	UringReader(const UringReader&) = delete;
+	UringReader& operator=(const UringReader&) = delete;
+
+	bool isValid() const;
+	unsigned queueDepth() const;
+
+	// Reads every file of the batch entirely
+	void read(std::vector<Job>& jobs);
+
+	static constexpr qint64 BlockSize = 0x10000; // 64K
+
+private:
+	struct Ring;
+	struct Slot;
+
+	void submit(int slotIndex, int descriptor, qint64 offset, qint64 length);
+	bool enter(unsigned minComplete);
+	void reap();
+
+	const unsigned _queueDepth;
+	std::unique_ptr<Ring> _ring;
+	std::vector<Slot> _slots;
+	std::vector<char> _buffers;
+};